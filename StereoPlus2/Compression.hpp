@@ -0,0 +1,213 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+
+// Variable length integers.
+// 7 bits per byte starting with the lowest ones.
+// The high bit of a byte is set when more bytes follow.
+struct Varint {
+	// Maps signed integers to unsigned so small negative values stay small.
+	// 0, -1, 1, -2, 2 ... -> 0, 1, 2, 3, 4 ...
+	static uint64_t ZigZag(int64_t v) {
+		return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+	}
+	static int64_t UnZigZag(uint64_t v) {
+		return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+	}
+
+	static void Put(std::vector<char>& buffer, uint64_t v) {
+		while (v >= 0x80) {
+			buffer.push_back((char)(v | 0x80));
+			v >>= 7;
+		}
+		buffer.push_back((char)v);
+	}
+	static uint64_t Get(const char*& pos, const char* end) {
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			if (pos == end)
+				throw std::runtime_error("Unexpected end of varint");
+
+			auto b = (unsigned char)*pos++;
+			v |= (uint64_t)(b & 0x7F) << shift;
+
+			if ((b & 0x80) == 0)
+				return v;
+		}
+
+		throw std::runtime_error("Varint is too long");
+	}
+};
+
+// Order-0 range asymmetric numeral system coder over bytes.
+// Fast to decode: a table lookup, a multiplication and at most one 16 bit read per byte.
+//
+// Block: varint size of the source, varint frequency of each byte value,
+// varint size of the encoded data followed by the data.
+class Rans {
+	static constexpr uint32_t probabilityBits = 12;
+	static constexpr uint32_t probabilityScale = 1 << probabilityBits;
+	// Lower bound of the coder state.
+	// The state is renormalized by 16 bits at most once per byte.
+	static constexpr uint32_t stateLow = 1u << 16;
+
+	using Frequencies = std::array<uint32_t, 256>;
+
+	// Scales byte counts to sum up to probabilityScale
+	// keeping every present byte at least 1.
+	static Frequencies Normalize(const std::array<uint64_t, 256>& counts, size_t total) {
+		Frequencies freq{};
+		uint32_t sum = 0;
+		size_t maxSymbol = 0;
+
+		for (size_t s = 0; s < 256; s++) {
+			if (counts[s] == 0)
+				continue;
+
+			freq[s] = (uint32_t)(counts[s] * probabilityScale / total);
+			if (freq[s] == 0)
+				freq[s] = 1;
+			sum += freq[s];
+
+			if (counts[s] > counts[maxSymbol])
+				maxSymbol = s;
+		}
+
+		// Rounding up rare bytes may overflow the scale.
+		// Take the excess from the largest frequencies.
+		while (sum > probabilityScale) {
+			size_t s = maxSymbol;
+			if (freq[s] <= 1)
+				for (size_t i = 0; i < 256; i++)
+					if (freq[i] > freq[s])
+						s = i;
+			auto d = std::min(freq[s] - 1, sum - probabilityScale);
+			freq[s] -= d;
+			sum -= d;
+		}
+		// The rest of the rounding error goes to the most frequent byte
+		// where it has the smallest relative impact.
+		freq[maxSymbol] += probabilityScale - sum;
+
+		return freq;
+	}
+
+public:
+	static std::vector<char> Encode(const char* data, size_t size) {
+		std::vector<char> out;
+		Varint::Put(out, size);
+		if (size == 0)
+			return out;
+
+		std::array<uint64_t, 256> counts{};
+		for (size_t i = 0; i < size; i++)
+			counts[(unsigned char)data[i]]++;
+
+		auto freq = Normalize(counts, size);
+		Frequencies start;
+		for (uint32_t s = 0, cumulative = 0; s < 256; s++) {
+			start[s] = cumulative;
+			cumulative += freq[s];
+		}
+
+		for (auto f : freq)
+			Varint::Put(out, f);
+
+		// rANS encodes backwards so the decoder can read forwards.
+		// Two interleaved states let the decoder work on two bytes at once.
+		std::vector<char> reversed;
+		reversed.reserve(size / 2 + 16);
+
+		uint32_t states[2] = { stateLow, stateLow };
+		for (size_t i = size; i-- > 0;) {
+			auto& state = states[i & 1];
+			auto s = (unsigned char)data[i];
+			uint32_t stateMax = ((stateLow >> probabilityBits) << 16) * freq[s];
+			if (state >= stateMax) {
+				reversed.push_back((char)(state & 0xFF));
+				reversed.push_back((char)((state >> 8) & 0xFF));
+				state >>= 16;
+			}
+			state = ((state / freq[s]) << probabilityBits) + (state % freq[s]) + start[s];
+		}
+		for (auto state : { states[1], states[0] })
+			for (int i = 0; i < 4; i++) {
+				reversed.push_back((char)(state & 0xFF));
+				state >>= 8;
+			}
+
+		Varint::Put(out, reversed.size());
+		out.insert(out.end(), reversed.rbegin(), reversed.rend());
+
+		return out;
+	}
+
+	static std::vector<char> Decode(const char* data, size_t size) {
+		auto pos = data;
+		auto end = data + size;
+
+		std::vector<char> out(Varint::Get(pos, end));
+		if (out.empty())
+			return out;
+
+		// Everything needed to decode a byte from a state slot.
+		struct Slot {
+			uint16_t freq;
+			uint16_t offset;
+			unsigned char symbol;
+		};
+		std::vector<Slot> slots(probabilityScale);
+
+		uint32_t cumulative = 0;
+		for (size_t s = 0; s < 256; s++) {
+			auto freq = Varint::Get(pos, end);
+			if (freq > probabilityScale - cumulative)
+				throw std::runtime_error("Corrupted frequency table");
+
+			for (uint32_t i = 0; i < freq; i++)
+				slots[cumulative + i] = { (uint16_t)freq, (uint16_t)i, (unsigned char)s };
+			cumulative += (uint32_t)freq;
+		}
+		if (cumulative != probabilityScale)
+			throw std::runtime_error("Corrupted frequency table");
+
+		auto encodedSize = Varint::Get(pos, end);
+		if (encodedSize < 8 || encodedSize > (size_t)(end - pos))
+			throw std::runtime_error("Corrupted encoded data");
+		end = pos + encodedSize;
+
+		uint32_t state0 = 0, state1 = 0;
+		for (int i = 0; i < 4; i++)
+			state0 = (state0 << 8) | (unsigned char)*pos++;
+		for (int i = 0; i < 4; i++)
+			state1 = (state1 << 8) | (unsigned char)*pos++;
+
+		const uint32_t mask = probabilityScale - 1;
+		auto decode = [&](uint32_t& state) {
+			auto& slot = slots[state & mask];
+			state = slot.freq * (state >> probabilityBits) + slot.offset;
+			if (state < stateLow) {
+				if (end - pos < 2)
+					throw std::runtime_error("Corrupted encoded data");
+				state = (state << 16) | ((unsigned char)pos[0] << 8) | (unsigned char)pos[1];
+				pos += 2;
+			}
+			return (char)slot.symbol;
+		};
+
+		size_t i = 0;
+		for (; i + 1 < out.size(); i += 2) {
+			out[i] = decode(state0);
+			out[i + 1] = decode(state1);
+		}
+		if (i < out.size())
+			out[i] = decode(state0);
+
+		return out;
+	}
+};
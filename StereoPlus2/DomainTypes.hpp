@@ -89,37 +89,49 @@ public:
 		HandleBeforeUpdate();
 		vertices.push_back(v);
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void AddVertices(const std::vector<glm::vec3>& vs) override {
-		for (auto v : vs)
-			AddVertice(v);
+		HandleBeforeUpdate();
+		vertices.insert(vertices.end(), vs.begin(), vs.end());
+		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVertice(size_t index, const glm::vec3& v) override {
 		HandleBeforeUpdate();
 		vertices[index] = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeX(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].x = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeY(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].y = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeZ(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].z = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVertices(const std::vector<glm::vec3>& vs) override {
 		HandleBeforeUpdate();
-		vertices.clear();
-		for (auto v : vs)
-			AddVertice(v);
+		vertices = vs;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
+	}
+	void SetVertices(std::vector<glm::vec3>&& vs) {
+		HandleBeforeUpdate();
+		vertices = std::move(vs);
+		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 
 	virtual void RemoveVertice() override {
@@ -127,6 +139,7 @@ public:
 		if (vertices.size() > 0)
 			vertices.pop_back();
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 
 	virtual void DesignProperties() override {
@@ -172,6 +185,13 @@ public:
 		glDrawArrays(GL_LINE_STRIP, 0, verticesCache.size());
 	}
 
+	virtual void CountMemory(MemoryUsage::SceneBytes& bytes) const override {
+		CountObject(this, bytes);
+		bytes.vertices += MemoryUsage::Of(vertices);
+		bytes.caches += MemoryUsage::Of(verticesCache);
+		bytes.eyeBuffers += MemoryUsage::Of(leftBuffer) + MemoryUsage::Of(rightBuffer);
+		bytes.gpuBuffers += sizeof(glm::vec3) * (leftBuffer.size() + rightBuffer.size());
+	}
 	SceneObject* Clone() const override {
 		return new PolyLine(this);
 	}
@@ -278,6 +298,7 @@ public:
 		HandleBeforeUpdate();
 		vertices.push_back(v);
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void AddVertices(const std::vector<glm::vec3>& vs) override {
 		for (auto v : vs)
@@ -287,21 +308,25 @@ public:
 		HandleBeforeUpdate();
 		vertices[index] = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeX(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].x = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeY(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].y = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeZ(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].z = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVertices(const std::vector<glm::vec3>& vs) override {
 		HandleBeforeUpdate();
@@ -309,6 +334,7 @@ public:
 		for (auto v : vs)
 			AddVertice(v);
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 
 	virtual void RemoveVertice() override {
@@ -316,6 +342,7 @@ public:
 		if (vertices.size() > 0)
 			vertices.pop_back();
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 
 	virtual void DesignProperties() override {
@@ -361,6 +388,13 @@ public:
 		glDrawArrays(GL_LINE_STRIP, 0, verticesCache.size());
 	}
 
+	virtual void CountMemory(MemoryUsage::SceneBytes& bytes) const override {
+		CountObject(this, bytes);
+		bytes.vertices += MemoryUsage::Of(vertices);
+		bytes.caches += MemoryUsage::Of(verticesCache);
+		bytes.eyeBuffers += MemoryUsage::Of(leftBuffer) + MemoryUsage::Of(rightBuffer);
+		bytes.gpuBuffers += sizeof(glm::vec3) * (leftBuffer.size() + rightBuffer.size());
+	}
 	SceneObject* Clone() const override {
 		return new SineCurve(this);
 	}
@@ -382,6 +416,7 @@ class Mesh : public LeafObject {
 	GLuint IBO;
 
 	bool shouldUpdateIBO = true;
+	size_t indexBufferSize = 0;
 
 	virtual void UpdateOpenGLBuffer(
 		std::function<glm::vec3(glm::vec3)> toLeft,
@@ -405,6 +440,7 @@ class Mesh : public LeafObject {
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(std::array<GLuint, 2>) * GetLinearConnections().size(), GetLinearConnections().data(), GL_DYNAMIC_DRAW);
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 			shouldUpdateIBO = false;
+			indexBufferSize = sizeof(std::array<GLuint, 2>) * GetLinearConnections().size();
 		}
 	}
 
@@ -467,6 +503,7 @@ public:
 		HandleBeforeUpdate();
 		connections.push_back({ p1, p2 });
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 		shouldUpdateIBO = true;
 	}
 	virtual void Disconnect(GLuint p1, GLuint p2) {
@@ -478,6 +515,7 @@ public:
 		HandleBeforeUpdate();
 		connections.erase(connections.begin() + pos);
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 		shouldUpdateIBO = true;
 	}
 
@@ -492,47 +530,71 @@ public:
 		HandleBeforeUpdate();
 		vertices.push_back(v);
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 		shouldUpdateIBO = true;
 	}
 	virtual void AddVertices(const std::vector<glm::vec3>& vs) override {
-		for (auto v : vs)
-			AddVertice(v);
+		HandleBeforeUpdate();
+		vertices.insert(vertices.end(), vs.begin(), vs.end());
+		shouldUpdateCache = true;
+		shouldSaveChanges = true;
+		shouldUpdateIBO = true;
 	}
 	virtual void SetVertice(size_t index, const glm::vec3& v) override {
 		HandleBeforeUpdate();
 		vertices[index] = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeX(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].x = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeY(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].y = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVerticeZ(size_t index, const float& v) override {
 		HandleBeforeUpdate();
 		vertices[index].z = v;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetVertices(const std::vector<glm::vec3>& vs) override {
 		HandleBeforeUpdate();
 		vertices = vs;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
+	}
+	void SetVertices(std::vector<glm::vec3>&& vs) {
+		HandleBeforeUpdate();
+		vertices = std::move(vs);
+		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 	}
 	virtual void SetConnections(const std::vector<std::array<GLuint, 2>>& connections) {
 		HandleBeforeUpdate();
 		this->connections = connections;
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
+		shouldUpdateIBO = true;
+	}
+	void SetConnections(std::vector<std::array<GLuint, 2>>&& connections) {
+		HandleBeforeUpdate();
+		this->connections = std::move(connections);
+		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 		shouldUpdateIBO = true;
 	}
 	virtual void RemoveVertice() override {
 		HandleBeforeUpdate();
 		vertices.pop_back();
 		shouldUpdateCache = true;
+		shouldSaveChanges = true;
 		shouldUpdateIBO = true;
 	}
 
@@ -559,6 +621,13 @@ public:
 	}
 
 
+	virtual void CountMemory(MemoryUsage::SceneBytes& bytes) const override {
+		CountObject(this, bytes);
+		bytes.vertices += MemoryUsage::Of(vertices) + MemoryUsage::Of(connections);
+		bytes.caches += MemoryUsage::Of(vertexCache);
+		bytes.eyeBuffers += MemoryUsage::Of(leftBuffer) + MemoryUsage::Of(rightBuffer);
+		bytes.gpuBuffers += sizeof(glm::vec3) * (leftBuffer.size() + rightBuffer.size()) + indexBufferSize;
+	}
 	SceneObject* Clone() const override {
 		return new Mesh(this);
 	}
@@ -630,6 +699,12 @@ public:
 		return PointT;
 	}
 
+	virtual void CountMemory(MemoryUsage::SceneBytes& bytes) const override {
+		CountObject(this, bytes);
+		bytes.vertices += MemoryUsage::Of(vertices);
+		bytes.eyeBuffers += MemoryUsage::Of(leftBuffer) + MemoryUsage::Of(rightBuffer);
+		bytes.gpuBuffers += sizeof(glm::vec3) * (leftBuffer.size() + rightBuffer.size());
+	}
 	SceneObject* Clone() const override {
 		return new PointObject(this);
 	}
@@ -788,6 +863,13 @@ public:
 
 		glDrawArrays(GL_LINES, 0, vertices.size());
 	}
+
+	virtual void CountMemory(MemoryUsage::SceneBytes& bytes) const override {
+		CountObject(this, bytes);
+		bytes.vertices += MemoryUsage::Of(vertices);
+		bytes.eyeBuffers += MemoryUsage::Of(leftBuffer) + MemoryUsage::Of(rightBuffer);
+		bytes.gpuBuffers += sizeof(glm::vec3) * (leftBuffer.size() + rightBuffer.size());
+	}
 };
 
 class Camera : public LeafObject
@@ -996,9 +1078,9 @@ public:
 	void DeleteSelected() {
 		for (auto o : ObjectSelection::Selected()) {
 			o->Reset();
-			(new FuncCommand())->func = [this, o] {
+			FuncCommand::Post([this, o] {
 				Delete(const_cast<SceneObject*>(o.Get()->GetParent()), o.Get());
-			};
+			});
 		}
 	}
 	void DeleteAll() {
@@ -1136,6 +1218,21 @@ public:
 		o->Name = ss.str();
 	}
 
+	// Counts the geometry of all objects and the cross
+	// and updates the scene categories of the memory usage.
+	static MemoryUsage::SceneBytes CountMemory() {
+		MemoryUsage::SceneBytes bytes;
+		for (auto& o : Objects().Get())
+			o->CountMemory(bytes);
+		if (auto r = root().Get().Get())
+			r->CountMemory(bytes);
+		if (cross().IsAssigned())
+			cross()->CountMemory(bytes);
+
+		MemoryUsage::Set(bytes);
+		return bytes;
+	}
+
 
 	~Scene() {
 		Objects().Get().clear();
@@ -3,6 +3,16 @@
 #include <stack>
 #include <algorithm>
 
+// Structured exception handling also recovers from access violations
+// in corrupted states. Other compilers only get C++ exceptions.
+#ifdef _MSC_VER
+#define STATE_TRY __try
+#define STATE_EXCEPT __except (EXCEPTION_EXECUTE_HANDLER)
+#else
+#define STATE_TRY try
+#define STATE_EXCEPT catch (...)
+#endif
+
 enum SelectPosition {
 	Anchor = 0x01,
 	Rest = 0x10,
@@ -79,6 +89,22 @@ private:
 		std::vector<SceneObject*> selection;
 
 		SceneObject* rootCopy;
+
+		MemoryUsage::Tracked trackedSize = MemoryUsage::Tracked(MemoryUsage::Category::UndoStates);
+
+		// Bytes held by the copies and the state itself.
+		size_t CountMemory() const {
+			MemoryUsage::SceneBytes bytes;
+			rootCopy->CountMemory(bytes);
+			for (auto& [o, copy] : copies)
+				copy->CountMemory(bytes);
+
+			// A map node holds the pair and about 4 pointers.
+			auto copiesSize = copies.size() * (sizeof(std::pair<SceneObject* const, SceneObject*>) + 4 * sizeof(void*));
+
+			return sizeof(State) + bytes.GetHostTotal() + copiesSize
+				+ MemoryUsage::Of(objects) + MemoryUsage::Of(selection);
+		}
 	};
 
 	StaticField(std::list<State*>, pastStates)
@@ -100,12 +126,14 @@ private:
 
 		if (current->objects.size() != current->copies.size()) {
 			logger().Error("The number of objects and the number their copies don't match.");
-			throw new std::exception("The number of objects and the number their copies don't match.");
+			throw new std::runtime_error("The number of objects and the number their copies don't match.");
 		}
 
 		for (auto& o : ObjectSelection::Selected())
 			current->selection.push_back(o.Get());
 
+		current->trackedSize.Set(current->CountMemory());
+
 		return current;
 	}
 
@@ -128,6 +156,8 @@ private:
 
 		for (auto& o : ObjectSelection::Selected())
 			current->selection.push_back(o.Get());
+
+		current->trackedSize.Set(current->CountMemory());
 	}
 
 	static void EraseOldestState() {
@@ -192,7 +222,7 @@ private:
 				AbortApply(newRoot, newCopies);
 				
 				SceneObject::isDeletionExpected().pop();
-				throw new std::exception("State change aborted.");
+				throw new std::runtime_error("State change aborted.");
 			}
 
 			if (p != nullptr)
@@ -206,7 +236,7 @@ private:
 					AbortApply(newRoot, newCopies);
 
 					SceneObject::isDeletionExpected().pop();
-					throw new std::exception("State change aborted.");
+					throw new std::runtime_error("State change aborted.");
 				}
 
 			return o;
@@ -231,7 +261,7 @@ private:
 			//		count++;
 
 			//if (count > 1)
-			//	throw new std::exception("Found 2 nodes pointing to the same object. Each node must correspond to 1 object.");
+			//	throw new std::runtime_error("Found 2 nodes pointing to the same object. Each node must correspond to 1 object.");
 		}
 
 
@@ -292,10 +322,10 @@ public:
 		if (pastStates().empty())
 			return;
 
-		__try {
+		STATE_TRY {
 			ApplyPast(Objects().Get());
 		}
-		__except (EXCEPTION_EXECUTE_HANDLER) {
+		STATE_EXCEPT {
 			logger().Error("Error occured in Rollback");
 			ClearPast();
 			return;
@@ -328,10 +358,10 @@ public:
 		if (futureStates().empty())
 			return;
 
-		__try {
+		STATE_TRY {
 			ApplyFuture(Objects().Get());
 		}
-		__except (EXCEPTION_EXECUTE_HANDLER) {
+		STATE_EXCEPT {
 			logger().Error("Error occured in Repeat");
 			ClearFuture();
 			return;
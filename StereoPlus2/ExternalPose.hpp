@@ -0,0 +1,356 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "Ws2_32.lib")
+#endif
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/mman.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+// Where the viewer position comes from.
+namespace PoseProvider {
+	// Face detection on the camera image.
+	const std::string Camera = "camera";
+	// Poses sent by another process to a local UDP port.
+	const std::string Udp = "udp";
+	// Poses written by another process to a shared memory ring.
+	const std::string SharedMemory = "sharedMemory";
+};
+
+// Viewer position produced by an external tracker.
+// Sent as is in little endian byte order.
+struct ExternalPoseMessage {
+	static constexpr uint32_t Signature = 0x50325053; // "SP2P"
+	static constexpr uint32_t CurrentVersion = 1;
+
+	uint32_t signature = Signature;
+	uint32_t version = CurrentVersion;
+	// Increases with every pose of the tracker.
+	uint64_t sequence = 0;
+	// Time the tracker captured the frame the pose was found in
+	// in microseconds of std::chrono::steady_clock.
+	// It is the same monotonic clock in every process of the machine
+	// (QueryPerformanceCounter on Windows, CLOCK_MONOTONIC on Linux).
+	// Zero when unknown, the receive time is used then.
+	int64_t captureTimeMicroseconds = 0;
+	// Horizontal, vertical position and distance to the screen center in millimeters
+	// as Camera::PositionModifier takes it.
+	float position[3] = {};
+	uint32_t reserved = 0;
+
+	bool IsValid() const {
+		return signature == Signature && version == CurrentVersion;
+	}
+
+	static int64_t Now() {
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+// Newest poses of a single writer.
+// A slot is rewritten in place so the reader checks its sequence
+// before and after copying and drops a torn message.
+struct SharedPoseRing {
+	static constexpr size_t SlotCount = 16;
+	static constexpr uint64_t BeingWritten = ~0ull;
+
+	struct Slot {
+		std::atomic<uint64_t> sequence;
+		ExternalPoseMessage message;
+	};
+
+	// Number of messages written since the ring was created.
+	std::atomic<uint64_t> writeCount;
+	Slot slots[SlotCount];
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory needs lock-free atomics");
+};
+
+// Local UDP socket bound to the loopback interface.
+class UdpPoseSocket {
+#ifdef _WIN32
+	using Handle = SOCKET;
+	static constexpr Handle InvalidHandle = INVALID_SOCKET;
+	bool isWsaStarted = false;
+#else
+	using Handle = int;
+	static constexpr Handle InvalidHandle = -1;
+#endif
+
+protected:
+	Handle handle = InvalidHandle;
+
+	static sockaddr_in Address(int port) {
+		sockaddr_in address = {};
+		address.sin_family = AF_INET;
+		address.sin_port = htons((uint16_t)port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		return address;
+	}
+
+	bool CreateSocket() {
+#ifdef _WIN32
+		WSADATA data;
+		if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+			return false;
+		isWsaStarted = true;
+#endif
+		handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		return handle != InvalidHandle;
+	}
+
+	bool SetNonBlocking() {
+#ifdef _WIN32
+		u_long isNonBlocking = 1;
+		return ioctlsocket(handle, FIONBIO, &isNonBlocking) == 0;
+#else
+		return fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+	}
+
+public:
+	~UdpPoseSocket() {
+#ifdef _WIN32
+		if (handle != InvalidHandle)
+			closesocket(handle);
+		if (isWsaStarted)
+			WSACleanup();
+#else
+		if (handle != InvalidHandle)
+			close(handle);
+#endif
+	}
+};
+
+// Memory mapping shared with the other process by name.
+class SharedPoseMemory {
+#ifdef _WIN32
+	HANDLE mapping = nullptr;
+#endif
+
+protected:
+	SharedPoseRing* ring = nullptr;
+
+	// Creates the ring when the other side hasn't yet.
+	bool Map(const std::string& name) {
+#ifdef _WIN32
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(SharedPoseRing), ("Local\\" + name).c_str());
+		if (!mapping)
+			return false;
+
+		ring = (SharedPoseRing*)MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedPoseRing));
+#else
+		auto file = shm_open(("/" + name).c_str(), O_CREAT | O_RDWR, 0600);
+		if (file < 0)
+			return false;
+
+		void* memory = ftruncate(file, sizeof(SharedPoseRing)) == 0
+			? mmap(nullptr, sizeof(SharedPoseRing), PROT_READ | PROT_WRITE, MAP_SHARED, file, 0)
+			: MAP_FAILED;
+		close(file);
+
+		ring = memory != MAP_FAILED ? (SharedPoseRing*)memory : nullptr;
+#endif
+		// New mappings are zeroed which is a valid empty ring.
+		return ring != nullptr;
+	}
+
+public:
+	~SharedPoseMemory() {
+#ifdef _WIN32
+		if (ring)
+			UnmapViewOfFile(ring);
+		if (mapping)
+			CloseHandle(mapping);
+#else
+		if (ring)
+			munmap(ring, sizeof(SharedPoseRing));
+#endif
+	}
+};
+
+// Takes poses of an external tracker without blocking.
+class ExternalPoseReceiver {
+public:
+	virtual ~ExternalPoseReceiver() {}
+
+	virtual bool Open() = 0;
+	// Returns false at once when there is no new message.
+	virtual bool TryReceive(ExternalPoseMessage& message) = 0;
+	// Returns when a message may have arrived or the timeout has passed.
+	virtual void Wait(std::chrono::milliseconds timeout) = 0;
+
+	// Returns nullptr for the camera and unknown providers.
+	static std::unique_ptr<ExternalPoseReceiver> Create(const std::string& provider, int port, const std::string& sharedMemoryName);
+};
+
+class UdpPoseReceiver : public ExternalPoseReceiver, UdpPoseSocket {
+	int port;
+
+public:
+	UdpPoseReceiver(int port) : port(port) {}
+
+	bool Open() override {
+		auto address = Address(port);
+		return CreateSocket()
+			&& bind(handle, (sockaddr*)&address, sizeof(address)) == 0
+			&& SetNonBlocking();
+	}
+
+	bool TryReceive(ExternalPoseMessage& message) override {
+		// Datagrams of other sizes aren't poses.
+		for (;;) {
+			auto size = recv(handle, (char*)&message, sizeof(message), 0);
+			if (size < 0)
+				return false;
+			if (size == sizeof(message) && message.IsValid())
+				return true;
+		}
+	}
+
+	void Wait(std::chrono::milliseconds timeout) override {
+		fd_set handles;
+		FD_ZERO(&handles);
+		FD_SET(handle, &handles);
+
+		timeval time = { (long)(timeout.count() / 1000), (long)(timeout.count() % 1000 * 1000) };
+		select((int)handle + 1, &handles, nullptr, nullptr, &time);
+	}
+};
+
+class SharedMemoryPoseReceiver : public ExternalPoseReceiver, SharedPoseMemory {
+	std::string name;
+	uint64_t readCount = 0;
+
+public:
+	SharedMemoryPoseReceiver(const std::string& name) : name(name) {}
+
+	bool Open() override {
+		if (!Map(name))
+			return false;
+
+		// Only poses written from now on are new.
+		readCount = ring->writeCount.load(std::memory_order_acquire);
+		return true;
+	}
+
+	bool TryReceive(ExternalPoseMessage& message) override {
+		auto count = ring->writeCount.load(std::memory_order_acquire);
+		if (count == readCount)
+			return false;
+
+		// Only the newest pose is of interest.
+		auto index = count - 1;
+		auto& slot = ring->slots[index % SharedPoseRing::SlotCount];
+		if (slot.sequence.load(std::memory_order_acquire) != index)
+			return false;
+
+		std::memcpy(&message, &slot.message, sizeof(message));
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		// The writer has come round to the slot while it was copied.
+		if (slot.sequence.load(std::memory_order_relaxed) != index || !message.IsValid())
+			return false;
+
+		readCount = count;
+		return true;
+	}
+
+	void Wait(std::chrono::milliseconds timeout) override {
+		// There is nothing to wait on so poll often enough not to add latency.
+		std::this_thread::sleep_for((std::min)(timeout, std::chrono::milliseconds(1)));
+	}
+};
+
+inline std::unique_ptr<ExternalPoseReceiver> ExternalPoseReceiver::Create(const std::string& provider, int port, const std::string& sharedMemoryName) {
+	if (provider == PoseProvider::Udp)
+		return std::make_unique<UdpPoseReceiver>(port);
+	if (provider == PoseProvider::SharedMemory)
+		return std::make_unique<SharedMemoryPoseReceiver>(sharedMemoryName);
+
+	return nullptr;
+}
+
+// Counterparts of the receivers for trackers written in C++ and for testing.
+class ExternalPoseSender {
+public:
+	virtual ~ExternalPoseSender() {}
+
+	virtual bool Open() = 0;
+	virtual bool Send(const ExternalPoseMessage& message) = 0;
+
+	static std::unique_ptr<ExternalPoseSender> Create(const std::string& provider, int port, const std::string& sharedMemoryName);
+};
+
+class UdpPoseSender : public ExternalPoseSender, UdpPoseSocket {
+	sockaddr_in address;
+
+public:
+	UdpPoseSender(int port) : address(Address(port)) {}
+
+	bool Open() override {
+		return CreateSocket();
+	}
+
+	bool Send(const ExternalPoseMessage& message) override {
+		return sendto(handle, (const char*)&message, sizeof(message), 0, (sockaddr*)&address, sizeof(address)) == sizeof(message);
+	}
+};
+
+class SharedMemoryPoseSender : public ExternalPoseSender, SharedPoseMemory {
+	std::string name;
+
+public:
+	SharedMemoryPoseSender(const std::string& name) : name(name) {}
+
+	bool Open() override {
+		return Map(name);
+	}
+
+	bool Send(const ExternalPoseMessage& message) override {
+		auto index = ring->writeCount.load(std::memory_order_relaxed);
+		auto& slot = ring->slots[index % SharedPoseRing::SlotCount];
+
+		slot.sequence.store(SharedPoseRing::BeingWritten, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		std::memcpy(&slot.message, &message, sizeof(message));
+		slot.sequence.store(index, std::memory_order_release);
+
+		ring->writeCount.store(index + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+inline std::unique_ptr<ExternalPoseSender> ExternalPoseSender::Create(const std::string& provider, int port, const std::string& sharedMemoryName) {
+	if (provider == PoseProvider::Udp)
+		return std::make_unique<UdpPoseSender>(port);
+	if (provider == PoseProvider::SharedMemory)
+		return std::make_unique<SharedMemoryPoseSender>(sharedMemoryName);
+
+	return nullptr;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "opencv2/objdetect.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/dnn.hpp"
+#include "opencv2/core/utility.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Time spent in each stage of face detection.
+struct FaceDetectionDurations {
+	std::chrono::steady_clock::duration downscale{};
+	std::chrono::steady_clock::duration grayConversion{};
+	std::chrono::steady_clock::duration equalization{};
+	std::chrono::steady_clock::duration detection{};
+	std::chrono::steady_clock::duration motionCheck{};
+};
+
+namespace FaceDetectorBackend {
+	const std::string Haar = "haar";
+	const std::string Lbp = "lbp";
+	const std::string Dnn = "dnn";
+
+	// In the order they are offered in the settings.
+	const std::vector<std::string> All = { Haar, Lbp, Dnn };
+};
+
+// Finds faces in a region of a camera frame.
+class FaceDetector {
+protected:
+	// Searches the installation and OpenCV sample directories.
+	static std::string FindFile(const std::string& path) {
+		return cv::samples::findFile(path, false, true);
+	}
+
+public:
+	template<typename F>
+	static void Measure(std::chrono::steady_clock::duration& total, F f) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		total += std::chrono::steady_clock::now() - start;
+	}
+
+	virtual ~FaceDetector() {}
+
+	virtual bool Load() = 0;
+	// Grayscale frames are enough unless the detector says otherwise.
+	virtual bool IsColorNeeded() const {
+		return false;
+	}
+
+	// Frame can be either BGR or grayscale.
+	// Faces are in frame coordinates.
+	// Empty min and max sizes don't restrict the face size.
+	virtual void Detect(
+		const cv::Mat& frame,
+		const cv::Rect& region,
+		cv::Size minSize,
+		cv::Size maxSize,
+		std::vector<cv::Rect>& faces,
+		FaceDetectionDurations& durations) = 0;
+
+	// Returns nullptr for an unknown backend.
+	static std::unique_ptr<FaceDetector> Create(const std::string& backend);
+	// Paths of the files the backend loads. Empty for an unknown backend.
+	static std::vector<std::string> GetFiles(const std::string& backend);
+
+	// Known backend with all of its files installed.
+	static bool IsAvailable(const std::string& backend) {
+		auto files = GetFiles(backend);
+		return !files.empty() && std::all_of(files.begin(), files.end(), [](const std::string& f) { return !FindFile(f).empty(); });
+	}
+};
+
+// Haar or LBP cascade depending on the file.
+class CascadeFaceDetector : public FaceDetector {
+	std::string path;
+	cv::CascadeClassifier cascade;
+	cv::Mat gray;
+
+public:
+	CascadeFaceDetector(const std::string& path) : path(path) {}
+
+	bool Load() override {
+		auto file = FindFile(path);
+		return !file.empty() && cascade.load(file);
+	}
+
+	void Detect(
+		const cv::Mat& frame,
+		const cv::Rect& region,
+		cv::Size minSize,
+		cv::Size maxSize,
+		std::vector<cv::Rect>& faces,
+		FaceDetectionDurations& durations) override {
+
+		if (frame.channels() == 1)
+			Measure(durations.equalization, [&] { equalizeHist(frame(region), gray); });
+		else {
+			Measure(durations.grayConversion, [&] { cvtColor(frame(region), gray, cv::COLOR_BGR2GRAY); });
+			Measure(durations.equalization, [&] { equalizeHist(gray, gray); });
+		}
+
+		Measure(durations.detection, [&] { cascade.detectMultiScale(gray, faces, 1.1, 3, 0, minSize, maxSize); });
+
+		for (auto& f : faces)
+			f += region.tl();
+	}
+};
+
+// Single shot detector network run by OpenCV on the CPU.
+// Expects the ResNet-10 SSD face model from the OpenCV samples.
+class DnnFaceDetector : public FaceDetector {
+	std::string modelPath;
+	std::string configPath;
+	cv::dnn::Net net;
+	cv::Mat bgr;
+
+public:
+	// Side of the square image the network takes.
+	int inputSize = 300;
+	float confidenceThreshold = 0.5f;
+
+	DnnFaceDetector(const std::string& modelPath, const std::string& configPath)
+		: modelPath(modelPath), configPath(configPath) {}
+
+	bool IsColorNeeded() const override {
+		return true;
+	}
+
+	bool Load() override {
+		auto model = FindFile(modelPath);
+		auto config = FindFile(configPath);
+		if (model.empty() || config.empty())
+			return false;
+
+		try {
+			net = cv::dnn::readNet(model, config);
+		}
+		catch (const cv::Exception&) {
+			return false;
+		}
+
+		net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+		net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+		return !net.empty();
+	}
+
+	void Detect(
+		const cv::Mat& frame,
+		const cv::Rect& region,
+		cv::Size minSize,
+		cv::Size maxSize,
+		std::vector<cv::Rect>& faces,
+		FaceDetectionDurations& durations) override {
+
+		faces.clear();
+
+		// The network was trained on color images.
+		auto image = frame(region);
+		if (frame.channels() == 1) {
+			Measure(durations.grayConversion, [&] { cvtColor(image, bgr, cv::COLOR_GRAY2BGR); });
+			image = bgr;
+		}
+
+		cv::Mat output;
+		Measure(durations.detection, [&] {
+			net.setInput(cv::dnn::blobFromImage(image, 1.0, cv::Size(inputSize, inputSize), cv::Scalar(104, 177, 123)));
+			output = net.forward();
+			});
+
+		// Rows of image id, class, confidence and relative corners.
+		cv::Mat detections(output.size[2], output.size[3], CV_32F, output.ptr<float>());
+		for (int i = 0; i < detections.rows; i++) {
+			if (detections.at<float>(i, 2) < confidenceThreshold)
+				continue;
+
+			auto face = cv::Rect(
+				cv::Point((int)(detections.at<float>(i, 3) * region.width), (int)(detections.at<float>(i, 4) * region.height)),
+				cv::Point((int)(detections.at<float>(i, 5) * region.width), (int)(detections.at<float>(i, 6) * region.height))
+			) & cv::Rect(cv::Point(), region.size());
+
+			if (face.empty()
+				|| (!minSize.empty() && (face.width < minSize.width || face.height < minSize.height))
+				|| (!maxSize.empty() && (face.width > maxSize.width || face.height > maxSize.height)))
+				continue;
+
+			faces.push_back(face + region.tl());
+		}
+	}
+};
+
+// Turns camera frames into what detection needs
+// before anything else goes over their pixels.
+// Cascades find faces down to 20-24 pixels high
+// so a few hundred lines are enough for a viewer in front of the screen.
+class DetectionFrameReducer {
+	cv::Mat downscaled;
+
+public:
+	// Height of reduced frames. Zero keeps the camera resolution.
+	int height = 240;
+	// Whether the detector takes color frames.
+	bool isColor = false;
+
+	// Reduced frame must not share data with the source frame.
+	void Reduce(const cv::Mat& frame, cv::Mat& reduced, FaceDetectionDurations& durations) {
+		auto source = &frame;
+		if (height > 0 && frame.rows > height) {
+			// Linear interpolation reads only the pixels around the samples.
+			// Area averaging costs more than the conversion it saves
+			// unless the size is exactly halved.
+			auto scale = (double)height / frame.rows;
+			FaceDetector::Measure(durations.downscale, [&] { cv::resize(frame, downscaled, cv::Size(), scale, scale, cv::INTER_LINEAR); });
+			source = &downscaled;
+		}
+
+		if (isColor || source->channels() == 1)
+			source->copyTo(reduced);
+		else
+			FaceDetector::Measure(durations.grayConversion, [&] { cvtColor(*source, reduced, cv::COLOR_BGR2GRAY); });
+	}
+};
+
+inline std::vector<std::string> FaceDetector::GetFiles(const std::string& backend) {
+	if (backend == FaceDetectorBackend::Haar)
+		return { "haarcascades/haarcascade_frontalface_alt.xml" };
+	if (backend == FaceDetectorBackend::Lbp)
+		return { "lbpcascades/lbpcascade_frontalface_improved.xml" };
+	if (backend == FaceDetectorBackend::Dnn)
+		return { "dnn/res10_300x300_ssd_iter_140000.caffemodel", "dnn/deploy.prototxt" };
+
+	return {};
+}
+
+inline std::unique_ptr<FaceDetector> FaceDetector::Create(const std::string& backend) {
+	auto files = GetFiles(backend);
+	if (backend == FaceDetectorBackend::Dnn)
+		return std::make_unique<DnnFaceDetector>(files[0], files[1]);
+	if (!files.empty())
+		return std::make_unique<CascadeFaceDetector>(files[0]);
+
+	return nullptr;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include "FaceDetection.hpp"
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <chrono>
+
+// Finds a face in camera frames.
+// Once a face is found the following frames are searched only around it
+// and only for faces of a similar size.
+// The whole frame is searched periodically and whenever the face is lost.
+// Frames where the image around the faces hasn't changed reuse the last result.
+class FaceTracker {
+	bool isTracking = false;
+	cv::Rect lastFace;
+	int framesSinceFullDetection = 0;
+
+	// Result of the last detection and a downscaled image around it.
+	std::vector<cv::Rect> lastFaces;
+	cv::Rect motionRegion;
+	cv::Mat motionReference;
+	cv::Mat motionSample;
+	int framesSinceDetection = 0;
+
+	static int Area(const cv::Rect& r) {
+		return r.width * r.height;
+	}
+
+	template<typename F>
+	void Measure(std::chrono::steady_clock::duration& total, F f) {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		total += std::chrono::steady_clock::now() - start;
+	}
+
+	cv::Rect Expand(const cv::Rect& r, cv::Size frameSize) const {
+		auto marginX = (int)(r.width * searchMargin);
+		auto marginY = (int)(r.height * searchMargin);
+
+		return cv::Rect(
+			r.x - marginX,
+			r.y - marginY,
+			r.width + marginX * 2,
+			r.height + marginY * 2
+		) & cv::Rect(cv::Point(), frameSize);
+	}
+
+	cv::Rect SearchRegion(cv::Size frameSize) const {
+		return Expand(lastFace, frameSize);
+	}
+
+	void TakeMotionSample(const cv::Mat& frame, cv::Mat& sample) {
+		Measure(durations.motionCheck, [&] {
+			cv::resize(frame(motionRegion), sample, cv::Size(motionSampleSize, motionSampleSize), 0, 0, cv::INTER_AREA);
+			});
+	}
+
+	void TakeMotionReference(const cv::Mat& frame) {
+		motionRegion = cv::Rect();
+		for (auto& f : lastFaces)
+			motionRegion |= Expand(f, frame.size());
+
+		TakeMotionSample(frame, motionReference);
+	}
+
+	// Whether the image around the faces is the same as at the last detection.
+	// Downscaling averages out the camera noise.
+	bool IsStill(const cv::Mat& frame) {
+		if (motionReference.empty() || motionRegion.br().x > frame.cols || motionRegion.br().y > frame.rows)
+			return false;
+
+		TakeMotionSample(frame, motionSample);
+		if (motionSample.type() != motionReference.type())
+			return false;
+
+		auto difference = cv::norm(motionSample, motionReference, cv::NORM_L1) / (motionSample.total() * motionSample.channels());
+		return difference < motionThreshold;
+	}
+
+	bool Track(FaceDetector& detector, const cv::Mat& frame, std::vector<cv::Rect>& faces) {
+		auto region = SearchRegion(frame.size());
+		auto minSize = cv::Size(
+			(int)(lastFace.width * (1 - sizeTolerance)),
+			(int)(lastFace.height * (1 - sizeTolerance)));
+		auto maxSize = cv::Size(
+			(int)(lastFace.width * (1 + sizeTolerance)),
+			(int)(lastFace.height * (1 + sizeTolerance)));
+
+		detector.Detect(frame, region, minSize, maxSize, faces, durations);
+		if (faces.empty())
+			return false;
+
+		// Keep the face closest to the previous one.
+		auto center = (lastFace.tl() + lastFace.br()) / 2;
+		auto closest = faces[0];
+		auto closestDistance = INT_MAX;
+		for (auto& f : faces) {
+			auto d = (f.tl() + f.br()) / 2 - center;
+			if (auto distance = d.dot(d); distance < closestDistance) {
+				closest = f;
+				closestDistance = distance;
+			}
+		}
+
+		lastFace = closest;
+		faces = { lastFace };
+		return true;
+	}
+
+	void DetectFull(FaceDetector& detector, const cv::Mat& frame, std::vector<cv::Rect>& faces) {
+		detector.Detect(frame, cv::Rect(cv::Point(), frame.size()), cv::Size(), cv::Size(), faces, durations);
+		framesSinceFullDetection = 0;
+
+		isTracking = isTrackingEnabled && !faces.empty();
+		if (!isTracking)
+			return;
+
+		// Follow the largest face as it's likely to be the closest viewer.
+		lastFace = *std::max_element(faces.begin(), faces.end(),
+			[](const cv::Rect& a, const cv::Rect& b) { return Area(a) < Area(b); });
+		faces = { lastFace };
+	}
+
+public:
+	FaceDetectionDurations durations;
+	// Number of frames that reused the last result.
+	size_t skippedFrameCount = 0;
+
+	bool isTrackingEnabled = true;
+	// Number of frames searched around the last face between full frame searches.
+	int fullDetectionPeriod = 30;
+	// Part of the face size added to each side of the search region.
+	float searchMargin = 0.5f;
+	// Relative difference of the face size allowed between frames.
+	float sizeTolerance = 0.25f;
+
+	bool isMotionGatingEnabled = true;
+	// Mean difference of pixel values in 0-255 below which the image is considered still.
+	float motionThreshold = 2;
+	// Detection still runs at least once per this number of frames.
+	int maxSkippedFrames = 15;
+	// Width and height of the downscaled image compared between frames.
+	int motionSampleSize = 16;
+
+	// Frame can be either BGR or grayscale.
+	std::vector<cv::Rect> Detect(FaceDetector& detector, const cv::Mat& frame) {
+		if (isMotionGatingEnabled
+			&& !lastFaces.empty()
+			&& framesSinceDetection < maxSkippedFrames
+			&& IsStill(frame)) {
+			framesSinceDetection++;
+			skippedFrameCount++;
+			return lastFaces;
+		}
+
+		std::vector<cv::Rect> faces;
+
+		if (!(isTracking
+			&& framesSinceFullDetection++ < fullDetectionPeriod
+			&& Track(detector, frame, faces)))
+			DetectFull(detector, frame, faces);
+
+		lastFaces = faces;
+		framesSinceDetection = 0;
+		if (isMotionGatingEnabled && !faces.empty())
+			TakeMotionReference(frame);
+
+		return faces;
+	}
+
+	void Reset() {
+		isTracking = false;
+		framesSinceFullDetection = 0;
+		lastFaces.clear();
+		framesSinceDetection = 0;
+	}
+};
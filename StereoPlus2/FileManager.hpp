@@ -1,13 +1,22 @@
 #pragma once
 
-#include "DomainUtils.hpp"
+#include "DomainTypes.hpp"
 #include <string>
 #include <iostream>
 #include "Json.hpp"
-
-class FileException : public std::exception {
+#include "Compression.hpp"
+#include "LineImport.hpp"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <unordered_set>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+class FileException : public std::runtime_error {
 public:
-	FileException(const char* message) : std::exception(message) {
+	FileException(const char* message) : std::runtime_error(message) {
 
 	}
 };
@@ -15,81 +24,115 @@ public:
 namespace FileType {
 	const std::string Json = "json";
 	const std::string So2 = "so2";
+	const std::string Obj = "obj";
+	const std::string Csv = "csv";
 };
 
 
+// Plain copy of scene object data.
+// It's taken on the main thread and can be serialized on any other
+// while the scene keeps changing.
+struct ObjectSnapshot {
+	ObjectType type;
+	std::string name;
+	glm::vec3 position;
+	glm::fquat rotation;
+	std::vector<glm::vec3> vertices;
+	std::vector<std::array<GLuint, 2>> connections;
+	std::vector<ObjectSnapshot> children;
+
+	// Takes the object and all its children.
+	// Ids are appended in the same order the objects are written to file.
+	static ObjectSnapshot Take(const SceneObject& so, std::vector<size_t>* ids = nullptr) {
+		auto v = TakeWithoutChildren(so);
+		if (ids)
+			ids->push_back(so.Id());
+
+		// Cross is not saved.
+		v.children.reserve(so.children.size());
+		for (auto c : so.children)
+			if (c->GetType() != CrossT)
+				v.children.push_back(Take(*c, ids));
+
+		return v;
+	}
+	static ObjectSnapshot TakeWithoutChildren(const SceneObject& so) {
+		ObjectSnapshot v;
+		v.type = so.GetType();
+		v.name = so.Name;
+		v.position = so.GetLocalPosition();
+		v.rotation = so.GetLocalRotation();
+
+		switch (so.GetType())
+		{
+		case Group:
+		case TraceObjectT:
+		case PointT:
+			break;
+		case PolyLineT:
+		case SineCurveT:
+			v.vertices = so.GetVertices();
+			break;
+		case MeshT:
+			v.vertices = so.GetVertices();
+			v.connections = ((Mesh*)&so)->GetLinearConnections();
+			break;
+		default:
+			throw std::runtime_error("Unsupported Scene Object Type found while writing file.");
+		}
+
+		return v;
+	}
+};
+
 class obstream {
 	std::vector<char> buffer;
 public:
 	template<typename TString>
 	void put(const TString& val) {
-		for (size_t i = 0; i < sizeof(TString); i++)
-			buffer.push_back(((char*)&val)[i]);
+		buffer.insert(buffer.end(), (const char*)&val, (const char*)&val + sizeof(TString));
 	}
-	template<>
-	void put<std::string>(const std::string& val) {
+	void put(const std::string& val) {
 		put(val.size());
-		for (size_t i = 0; i < val.size(); i++)
-			buffer.push_back(val[i]);
+		buffer.insert(buffer.end(), val.begin(), val.end());
 	}
-	template<>
-	void put<SceneObject>(const SceneObject& so) {
-		if (so.GetType() == CrossT)
-			return;
+	void put(const ObjectSnapshot& o) {
+		put(o.type);
+		put(o.name);
+		put(o.position);
+		put(o.rotation);
 
-		put(so.GetType());
-		put(so.Name);
-		put(so.GetLocalPosition());
-		put(so.GetLocalRotation());
-
-		switch (so.GetType())
+		switch (o.type)
 		{
 		case Group:
 		case TraceObjectT:
 		case PointT:
 			break;
 		case PolyLineT:
-		{
-			auto o = (PolyLine*)&so;
-
-			put(o->GetVertices().size());
-			for (auto p : o->GetVertices())
-				put(p);
-
-			break;
-		}
 		case SineCurveT:
-		{
-			auto o = (SineCurve*)&so;
-
-			put(o->GetVertices().size());
-			for (auto p : o->GetVertices())
-				put(p);
-
+			putArray(o.vertices);
 			break;
-		}
 		case MeshT:
-		{
-			auto o = (Mesh*)&so;
-
-			put(o->GetVertices().size());
-			for (auto p : o->GetVertices())
-				put(p);
-
-			put(o->GetLinearConnections().size());
-			for (auto c : o->GetLinearConnections())
-				for (auto p : c)
-					put(p);
-
+			putArray(o.vertices);
+			putArray(o.connections);
 			break;
-		}
 		default:
-			throw std::exception("Unsupported Scene Object Type found while writing file.");
+			throw std::runtime_error("Unsupported Scene Object Type found while writing file.");
 		}
 
-		put(so.children.size());
-		for (auto c : so.children)
-			put(*c);
+		put(o.children.size());
+		for (auto& c : o.children)
+			put(c);
+	}
+	void put(const SceneObject& so) {
+		put(ObjectSnapshot::Take(so));
+	}
+
+	// Size followed by raw items.
+	template<typename T>
+	void putArray(const std::vector<T>& v) {
+		put(v.size());
+		buffer.insert(buffer.end(), (const char*)v.data(), (const char*)(v.data() + v.size()));
 	}
 
 	const char* getBuffer() {
@@ -99,6 +142,10 @@ public:
 	size_t getSize() {
 		return buffer.size();
 	}
+
+	std::vector<char> releaseBuffer() {
+		return std::move(buffer);
+	}
 };
 
 class ibstream {
@@ -115,7 +162,6 @@ class ibstream {
 	void read(std::function<void(T)> f) {
 		f(get<T>());
 	}
-	template<>
 	void read(std::string* dest) {
 		auto size = get<size_t>();
 		*dest = get<std::string>(size);
@@ -141,20 +187,7 @@ class ibstream {
 			objects.push_back(o);
 		return o;
 	}
-public:
-	std::vector<SceneObject*> objects;
-
-	template<typename T>
-	T get(size_t size = sizeof(T)) {
-		T val;
-
-		for (size_t i = 0; i < size; i++, pos++)
-			((char*)&val)[i] = buffer[pos];
-
-		return val;
-	}
-	template<>
-	std::string get<std::string>(size_t size) {
+	std::string getString(size_t size) {
 		std::string val;
 
 		for (size_t i = 0; i < size; i++, pos++)
@@ -162,8 +195,7 @@ public:
 
 		return val;
 	}
-	template<>
-	SceneObject* get<SceneObject*>(size_t _) {
+	SceneObject* getObject() {
 		auto type = get<ObjectType>();
 
 		switch (type)
@@ -228,7 +260,26 @@ public:
 		}
 		default:
 			log.Error("Unsupported Scene Object Type found while reading file.");
-			throw std::exception("Unsupported Scene Object Type found while reading file.");
+			throw std::runtime_error("Unsupported Scene Object Type found while reading file.");
+		}
+	}
+
+public:
+	std::vector<SceneObject*> objects;
+
+	template<typename T>
+	T get(size_t size = sizeof(T)) {
+		if constexpr (std::is_same_v<T, std::string>)
+			return getString(size);
+		else if constexpr (std::is_same_v<T, SceneObject*>)
+			return getObject();
+		else {
+			T val;
+
+			for (size_t i = 0; i < size; i++, pos++)
+				((char*)&val)[i] = buffer[pos];
+
+			return val;
 		}
 	}
 
@@ -240,6 +291,247 @@ public:
 	}
 };
 
+// Parameters of so2 file writing.
+// Taken from settings on the main thread since background saves
+// shouldn't read settings while they can be changed.
+struct So2Encoding {
+	// Compact files start with "SO2C".
+	// Plain ones start with the type of the root which is always Group.
+	static constexpr uint32_t magic = 0x43324F53;
+	static constexpr uint8_t version = 1;
+	static constexpr uint8_t compressedFlag = 0x1;
+
+	bool isCompact = false;
+	float precisionMillimeters = 0.01;
+	bool isCompressed = false;
+
+	static So2Encoding FromSettings() {
+		So2Encoding v;
+		v.isCompact = Settings::IsCompactFileEncodingEnabled().Get();
+		v.precisionMillimeters = Settings::FilePrecisionMillimeters().Get();
+		v.isCompressed = Settings::IsFileCompressionEnabled().Get();
+		return v;
+	}
+};
+
+// Compact so2 writer.
+// Sizes, types and connections are varints.
+// Positions and vertices are quantized in the local space of their object
+// with the precision written at the start.
+// Vertices are written as zig-zag varint differences between consecutive vertices
+// which are small for lines drawn by hand.
+class obcstream {
+	std::vector<char> buffer;
+	float precision;
+
+	int64_t quantize(float v) {
+		auto q = v / precision;
+		if (!(std::abs(q) < 1e18f))
+			throw std::runtime_error("Value can't be quantized with the given precision.");
+
+		return std::llround(q);
+	}
+
+	template<typename T>
+	void putRaw(const T& val) {
+		buffer.insert(buffer.end(), (const char*)&val, (const char*)&val + sizeof(T));
+	}
+	void put(uint64_t val) {
+		Varint::Put(buffer, val);
+	}
+	void put(const std::string& val) {
+		put(val.size());
+		buffer.insert(buffer.end(), val.begin(), val.end());
+	}
+	void putVertices(const std::vector<glm::vec3>& vertices) {
+		put(vertices.size());
+		if (vertices.empty())
+			return;
+
+		int64_t previous[3] = { 0, 0, 0 };
+		for (auto& v : vertices)
+			for (int i = 0; i < 3; i++) {
+				auto q = quantize(v[i]);
+				put(Varint::ZigZag(q - previous[i]));
+				previous[i] = q;
+			}
+	}
+	void putConnections(const std::vector<std::array<GLuint, 2>>& connections) {
+		put(connections.size());
+
+		int64_t previous = 0;
+		for (auto& c : connections) {
+			put(Varint::ZigZag((int64_t)c[0] - previous));
+			put(Varint::ZigZag((int64_t)c[1] - c[0]));
+			previous = c[0];
+		}
+	}
+public:
+	obcstream(float precisionMillimeters) : precision(precisionMillimeters) {
+		if (!(precision > 0))
+			throw std::runtime_error("File precision must be positive.");
+
+		putRaw(precision);
+	}
+
+	void put(const ObjectSnapshot& o) {
+		put(o.type);
+		put(o.name);
+		for (int i = 0; i < 3; i++)
+			put(Varint::ZigZag(quantize(o.position[i])));
+		putRaw(o.rotation);
+
+		switch (o.type)
+		{
+		case Group:
+		case TraceObjectT:
+		case PointT:
+			break;
+		case PolyLineT:
+		case SineCurveT:
+			putVertices(o.vertices);
+			break;
+		case MeshT:
+			putVertices(o.vertices);
+			putConnections(o.connections);
+			break;
+		default:
+			throw std::runtime_error("Unsupported Scene Object Type found while writing file.");
+		}
+
+		put(o.children.size());
+		for (auto& c : o.children)
+			put(c);
+	}
+
+	std::vector<char> releaseBuffer() {
+		return std::move(buffer);
+	}
+};
+
+// Compact so2 reader.
+class ibcstream {
+	const char* pos = nullptr;
+	const char* end = nullptr;
+	float precision = 0;
+
+	uint64_t get() {
+		return Varint::Get(pos, end);
+	}
+	template<typename T>
+	T getRaw() {
+		if ((size_t)(end - pos) < sizeof(T))
+			throw std::runtime_error("Unexpected end of file.");
+
+		T val;
+		memcpy(&val, pos, sizeof(T));
+		pos += sizeof(T);
+		return val;
+	}
+	std::string getString() {
+		auto size = get();
+		if ((size_t)(end - pos) < size)
+			throw std::runtime_error("Unexpected end of file.");
+
+		std::string val(pos, size);
+		pos += size;
+		return val;
+	}
+	std::vector<glm::vec3> getVertices() {
+		std::vector<glm::vec3> vertices(get());
+		if (vertices.empty())
+			return vertices;
+
+		int64_t previous[3] = { 0, 0, 0 };
+		for (auto& v : vertices)
+			for (int i = 0; i < 3; i++) {
+				previous[i] += Varint::UnZigZag(get());
+				v[i] = previous[i] * precision;
+			}
+
+		return vertices;
+	}
+	std::vector<std::array<GLuint, 2>> getConnections() {
+		std::vector<std::array<GLuint, 2>> connections(get());
+
+		int64_t previous = 0;
+		for (auto& c : connections) {
+			previous += Varint::UnZigZag(get());
+			c[0] = (GLuint)previous;
+			c[1] = (GLuint)(previous + Varint::UnZigZag(get()));
+		}
+
+		return connections;
+	}
+
+	static SceneObject* create(ObjectType type) {
+		switch (type)
+		{
+		case Group:
+			return new GroupObject();
+		case PointT:
+			return new PointObject();
+		case PolyLineT:
+			return new PolyLine();
+		case SineCurveT:
+			return new SineCurve();
+		case MeshT:
+			return new Mesh();
+		case TraceObjectT:
+			return new TraceObject();
+		default:
+			throw std::runtime_error("Unsupported Scene Object Type found while reading file.");
+		}
+	}
+	SceneObject* getObject(bool isRoot) {
+		auto o = create((ObjectType)get());
+		if (!isRoot)
+			objects.push_back(o);
+
+		o->Name = getString();
+		glm::vec3 position;
+		for (int i = 0; i < 3; i++)
+			position[i] = Varint::UnZigZag(get()) * precision;
+		o->SetLocalPosition(position);
+		o->SetLocalRotation(getRaw<glm::fquat>());
+
+		switch (o->GetType())
+		{
+		case PolyLineT:
+		case SineCurveT:
+			o->SetVertices(getVertices());
+			break;
+		case MeshT:
+			o->SetVertices(getVertices());
+			((Mesh*)o)->SetConnections(getConnections());
+			break;
+		default:
+			break;
+		}
+
+		auto childCount = get();
+		for (size_t i = 0; i < childCount; i++)
+			getObject(false)->SetParent(o);
+
+		return o;
+	}
+public:
+	// All objects except the root in file order.
+	std::vector<SceneObject*> objects;
+
+	ibcstream& setBuffer(const char* buf, size_t size) {
+		pos = buf;
+		end = buf + size;
+
+		return *this;
+	}
+
+	SceneObject* getRoot() {
+		precision = getRaw<float>();
+		return getObject(true);
+	}
+};
+
 class JsonConvert {
 
 	static bool& isRoot() {
@@ -258,28 +550,28 @@ class JsonConvert {
 	}
 
 	template<typename T>
-	static void get(Js::Object* joa, std::string name, T& dest) {
-		dest = get<T>(joa->objects[name]);
+	static void get(const Jv::Object* joa, std::string_view name, T& dest) {
+		dest = get<T>(joa->Find(name));
 	}
 	template<typename T>
-	static void get(Js::Object* joa, std::string name, std::function<void(T)> dest) {
-		dest(get<T>(joa->objects[name]));
+	static void get(const Jv::Object* joa, std::string_view name, std::function<void(T)> dest) {
+		dest(get<T>(joa->Find(name)));
 	}
 	template<typename...T>
-	static void getArray(Js::Object* jo, std::string name, std::function<void(T...)> f) {
-		auto j = (Js::Array*)jo->objects[name];
-		for (auto o : j->objects)
+	static void getArray(const Jv::Object* jo, std::string_view name, std::function<void(T...)> f) {
+		auto j = (const Jv::Array*)jo->Find(name);
+		for (auto o : *j)
 			f(get<T>(o)...);
 	}
-	static void getArray(Js::Object* jo, std::string name, std::function<void(size_t, size_t)> f) {
-		auto j = (Js::Array*)jo->objects[name];
-		for (auto o : j->objects) {
+	static void getArray(const Jv::Object* jo, std::string_view name, std::function<void(size_t, size_t)> f) {
+		auto j = (const Jv::Array*)jo->Find(name);
+		for (auto o : *j) {
 			auto v = get<size_t, 2>(o);
 			f(v[0], v[1]);
 		}
 	}
 
-	static void getChildren(Js::Object* j, std::string name, SceneObject* parent) {
+	static void getChildren(const Jv::Object* j, std::string_view name, SceneObject* parent) {
 		getArray(j, name, std::function([&parent](SceneObject* v) {
 			v->SetParent(parent);
 			}));
@@ -312,64 +604,61 @@ public:
 
 	template<typename T>
 	static T get(std::string str) {
-		std::stringstream ss;
-		ss << str;
-		T val;
-		ss >> val;
-		return val;
-	}
-	template<>
-	static ObjectType get(std::string str) {
-		return (ObjectType)get<int>(str);
+		if constexpr (std::is_same_v<T, ObjectType>)
+			return (ObjectType)get<int>(str);
+		else {
+			std::stringstream ss;
+			ss << str;
+			T val;
+			ss >> val;
+			return val;
+		}
 	}
 
 	template<typename T>
-	static T get(Js::ObjectAbstract* joa) {
-		auto j = (Js::Primitive*)joa;
-		return get<T>(j->value);
-	}
-	template<>
-	static std::string get(Js::ObjectAbstract* joa) {
-		auto j = (Js::PrimitiveString*)joa;
-		return get<std::string>(j->value);
-	}
-	template<>
-	static glm::vec3 get(Js::ObjectAbstract* joa) {
-		auto j = (Js::Array*)joa;
-		glm::vec3 v;
-		for (size_t i = 0; i < j->objects.size(); i++)
-			((float*)&v)[i] = get<float>(j->objects[i]);
+	static T get(const Jv::ObjectAbstract* joa) {
+		if constexpr (std::is_same_v<T, std::string>)
+			return std::string(((const Jv::PrimitiveString*)joa)->value);
+		else if constexpr (std::is_same_v<T, glm::vec3> || std::is_same_v<T, glm::fquat>)
+			return getFloats<T>(joa);
+		else if constexpr (std::is_same_v<T, std::vector<SceneObject*>>)
+			return getObjects(joa);
+		else if constexpr (std::is_same_v<T, SceneObject*>)
+			return getObject(joa);
+		else {
+			auto j = (const Jv::Primitive*)joa;
+			return get<T>(std::string(j->value));
+		}
+	}
+	template<typename T, size_t S>
+	static std::array<T, S> get(const Jv::ObjectAbstract* joa) {
+		auto j = (const Jv::Array*)joa;
+		std::array<T, S> v;
+		for (size_t i = 0; i < S; i++) {
+			v[i] = get<T>((*j)[i]);
+		}
 		return v;
 	}
-	template<>
-	static glm::fquat get(Js::ObjectAbstract* joa) {
-		auto j = (Js::Array*)joa;
-		glm::fquat v;
-		for (size_t i = 0; i < j->objects.size(); i++)
-			((float*)&v)[i] = get<float>(j->objects[i]);
+
+private:
+	template<typename T>
+	static T getFloats(const Jv::ObjectAbstract* joa) {
+		auto j = (const Jv::Array*)joa;
+		T v;
+		for (size_t i = 0; i < j->size; i++)
+			((float*)&v)[i] = get<float>((*j)[i]);
 		return v;
 	}
-	template<>
-	static std::vector<SceneObject*> get(Js::ObjectAbstract* joa) {
-		auto j = (Js::Array*)joa;
+	static std::vector<SceneObject*> getObjects(const Jv::ObjectAbstract* joa) {
+		auto j = (const Jv::Array*)joa;
 		std::vector<SceneObject*> v;
-		for (auto p : j->objects)
+		for (auto p : *j)
 			v.push_back(get<SceneObject*>(p));
 		return v;
 	}
-	template<typename T, size_t S>
-	static std::array<T, S> get(Js::ObjectAbstract* joa) {
-		auto j = (Js::Array*)joa;
-		std::array<T, S> v;
-		for (size_t i = 0; i < S; i++) {
-			v[i] = get<T>(j->objects[i]);
-		}
-		return v;
-	}
-	template<>
-	static SceneObject* get(Js::ObjectAbstract* joa) {
-		auto j = (Js::Object*)joa;
-		auto type = get<ObjectType>(j->objects["type"]);
+	static SceneObject* getObject(const Jv::ObjectAbstract* joa) {
+		auto j = (const Jv::Object*)joa;
+		auto type = get<ObjectType>(j->Find("type"));
 		switch (type) {
 		case Group:
 		{
@@ -435,40 +724,36 @@ public:
 			break;
 		}
 
-		throw std::exception("Unsupported Scene Object Type found while reading file.");
+		throw std::runtime_error("Unsupported Scene Object Type found while reading file.");
 	}
 
+public:
 	template<typename T>
 	static Js::ObjectAbstract* serialize(const T& o) {
 		auto j = new Js::Primitive();
 		j->value = toString(o);
 		return j;
 	}
-	template<>
 	static Js::ObjectAbstract* serialize(const std::string& o) {
 		auto j = new Js::PrimitiveString();
 		j->value = o;
 		return j;
 	}
-	template<>
 	static Js::ObjectAbstract* serialize(const glm::vec2& o) {
 		auto j = new Js::Array();
 		j->objects = { serialize(o.x), serialize(o.y) };
 		return j;
 	}
-	template<>
 	static Js::ObjectAbstract* serialize(const glm::vec3& o) {
 		auto j = new Js::Array();
 		j->objects = { serialize(o.x), serialize(o.y), serialize(o.z) };
 		return j;
 	}
-	template<>
 	static Js::ObjectAbstract* serialize(const glm::vec4& o) {
 		auto j = new Js::Array();
 		j->objects = { serialize(o.x), serialize(o.y), serialize(o.z), serialize(o.w) };
 		return j;
 	}
-	template<>
 	static Js::ObjectAbstract* serialize(const glm::fquat& o) {
 		auto j = new Js::Array();
 		j->objects = { serialize(o.x), serialize(o.y), serialize(o.z), serialize(o.w) };
@@ -489,14 +774,13 @@ public:
 			j->objects.push_back(serialize(a));
 		return j;
 	}
-	template<typename T, GLuint S>
+	template<typename T, size_t S>
 	static Js::ObjectAbstract* serialize(const std::array<T, S>& v) {
 		auto j = new Js::Array();
 		for (auto a : v)
 			j->objects.push_back(serialize(a));
 		return j;
 	}
-	template<>
 	static Js::ObjectAbstract* serialize(const SceneObject& so) {
 		if (so.GetType() == CrossT)
 			return nullptr;
@@ -589,7 +873,7 @@ class FileManager {
 	static void LoadJson(std::string filename, Scene* inScene) {
 		auto json = Json::Read(filename);
 		JsonConvert::Reset();
-		auto root = JsonConvert::get<SceneObject*>(json);
+		auto root = JsonConvert::get<SceneObject*>(json->Root());
 		
 		inScene->root() = root;
 
@@ -600,38 +884,514 @@ class FileManager {
 		inScene->Objects() = newObjects;
 	}
 
-	static void SaveBinary(std::string filename, Scene* inScene) {
-		std::ofstream file(filename, std::ios::binary | std::ios::out);
+	// Writes to a temporary file and then replaces the destination
+	// so the destination is never left partially written.
+	static void WriteAtomic(const std::string& filename, const char* data, size_t size) {
+		auto tempFilename = filename + ".tmp";
+		{
+			std::ofstream file(tempFilename, std::ios::binary | std::ios::out | std::ios::trunc);
+			file.write(data, size);
+			file.flush();
+
+			if (!file)
+				Fail("Failed to write temporary file");
+		}
+
+		std::error_code error;
+		fs::rename(tempFilename, filename, error);
+		if (error)
+			Fail("Failed to replace file");
+	}
+
+	static std::vector<char> EncodeBinary(const ObjectSnapshot& root, const So2Encoding& encoding) {
+		if (!encoding.isCompact) {
+			auto bs = obstream();
+			bs.put(root);
+			return bs.releaseBuffer();
+		}
 
-		auto bs = obstream();
-		bs.put(*inScene->root().Get().Get());
+		auto cs = obcstream(encoding.precisionMillimeters);
+		cs.put(root);
+		auto body = cs.releaseBuffer();
 
-		file.write(bs.getBuffer(), bs.getSize());
+		auto header = obstream();
+		header.put(So2Encoding::magic);
+		header.put(So2Encoding::version);
+		header.put(encoding.isCompressed ? So2Encoding::compressedFlag : (uint8_t)0);
+		auto data = header.releaseBuffer();
+
+		if (encoding.isCompressed) {
+			auto compressed = Rans::Encode(body.data(), body.size());
+			data.insert(data.end(), compressed.begin(), compressed.end());
+		}
+		else
+			data.insert(data.end(), body.begin(), body.end());
 
-		file.close();
+		return data;
 	}
-	static void LoadBinary(std::string filename, Scene* inScene) {
+	// Reads both plain and compact so2.
+	// Objects except the root are added to objects in file order.
+	static SceneObject* DecodeBinary(char* buffer, size_t size, std::vector<SceneObject*>& objects) {
+		const size_t headerSize = sizeof(uint32_t) + 2 * sizeof(uint8_t);
+
+		uint32_t magic = 0;
+		if (size >= headerSize)
+			memcpy(&magic, buffer, sizeof(magic));
+
+		if (magic != So2Encoding::magic) {
+			ibstream str;
+			str.setBuffer(buffer);
+			auto root = str.get<SceneObject*>();
+			objects = std::move(str.objects);
+			return root;
+		}
+
+		auto version = (uint8_t)buffer[sizeof(uint32_t)];
+		auto flags = (uint8_t)buffer[sizeof(uint32_t) + 1];
+		if (version != So2Encoding::version)
+			Fail("File version not supported");
+
+		ibcstream str;
+		std::vector<char> decompressed;
+		if (flags & So2Encoding::compressedFlag) {
+			decompressed = Rans::Decode(buffer + headerSize, size - headerSize);
+			str.setBuffer(decompressed.data(), decompressed.size());
+		}
+		else
+			str.setBuffer(buffer + headerSize, size - headerSize);
+
+		auto root = str.getRoot();
+		objects = std::move(str.objects);
+		return root;
+	}
+
+	static void SaveBinary(std::string filename, const ObjectSnapshot& root, const So2Encoding& encoding) {
+		auto start = std::chrono::steady_clock::now();
+
+		auto data = EncodeBinary(root, encoding);
+		WriteAtomic(filename, data.data(), data.size());
+
+		LastSaveBytes() = data.size();
+		LastSaveDurationMicroseconds() = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+	static void SaveBinary(std::string filename, Scene* inScene) {
+		SaveBinary(filename, ObjectSnapshot::Take(*inScene->root().Get().Get()), So2Encoding::FromSettings());
+	}
+
+	static std::vector<char> ReadBinary(const std::string& filename) {
 		std::ifstream file(filename, std::ios::binary | std::ios::in);
+		if (!file)
+			Fail("Failed to open file");
 
-		auto bufferSize = GetFileSize(filename);
+		std::vector<char> buffer(GetFileSize(filename));
+		file.read(buffer.data(), buffer.size());
+
+		return buffer;
+	}
+
+	// FNV-1a. Detects torn journal writes and outdated scene files.
+	static uint64_t Hash(const char* data, size_t size) {
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++) {
+			hash ^= (unsigned char)data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	struct BackgroundSave {
+		std::thread thread;
+		std::atomic<bool> isRunning = false;
+
+		void Wait() {
+			if (thread.joinable())
+				thread.join();
+		}
+		~BackgroundSave() {
+			Wait();
+		}
+	};
+	static BackgroundSave& backgroundSave() {
+		static BackgroundSave v;
+		return v;
+	}
+
+	// Returns false if the previous background save is still running.
+	static bool RunInBackground(std::function<void()> save) {
+		auto& backgroundSave = FileManager::backgroundSave();
+		if (backgroundSave.isRunning) {
+			GetLog().Warning("Previous background save is still running. Skipping save.");
+			return false;
+		}
+		backgroundSave.Wait();
+
+		backgroundSave.isRunning = true;
+		backgroundSave.thread = std::thread([save, &backgroundSave] {
+			try {
+				save();
+			}
+			catch (FileException* e) {
+				changeJournal().shouldCompact = true;
+				delete e;
+			}
+			catch (std::exception& e) {
+				changeJournal().shouldCompact = true;
+				GetLog().Error("Background save failed: ", e.what());
+			}
+
+			backgroundSave.isRunning = false;
+			});
+
+		return true;
+	}
+
+	// Append-only log of scene changes written next to an so2 file.
+	// 
+	// Header: magic, size and hash of the so2 file the journal is based on
+	// and ids of its objects in file order.
+	// Batch: payload size and hash followed by the payload 
+	// with ids of deleted objects and changed objects.
+	// Changed object is written without children together with 
+	// the id of its parent and its position among the parent's children.
+	// Changed objects are written in tree order so a parent 
+	// is always replayed before its children.
+	struct ChangeJournal {
+		static constexpr uint32_t magic = 0x4A324F53;
+		static constexpr size_t noParent = (size_t)-1;
+
+		// After this many batches the journal is compacted 
+		// even if it's still smaller than the scene.
+		static constexpr size_t maxBatchCount = 64;
+
+		struct Record {
+			size_t id;
+			size_t parentId;
+			size_t index;
+			ObjectSnapshot object;
+		};
+
+		// Accessed only on the main thread.
+		std::string filename;
+		size_t rootId = 0;
+		size_t batchCount = 0;
+		std::unordered_set<size_t> savedIds;
+
+		// Updated by background saves.
+		std::atomic<bool> shouldCompact = true;
+		std::atomic<size_t> baseBytes = 0;
+		std::atomic<size_t> journalBytes = 0;
+
+		static std::string GetFileName(const std::string& sceneFilename) {
+			return sceneFilename + ".journal";
+		}
+	};
+	static ChangeJournal& changeJournal() {
+		static ChangeJournal v;
+		return v;
+	}
+
+	// Writes the whole scene and starts a new journal based on it.
+	static bool StartCompaction(const std::string& filename, SceneObject* root) {
+		if (backgroundSave().isRunning) {
+			GetLog().Warning("Previous background save is still running. Skipping save.");
+			return false;
+		}
+
+		std::vector<size_t> ids;
+		auto snapshot = ObjectSnapshot::Take(*root, &ids);
+		root->CallRecursive([](SceneObject* o) { o->ResetShouldSaveChanges(); });
+
+		auto& journal = changeJournal();
+		journal.filename = filename;
+		journal.rootId = root->Id();
+		journal.batchCount = 0;
+		journal.savedIds = std::unordered_set<size_t>(ids.begin(), ids.end());
+		journal.shouldCompact = false;
+
+		return RunInBackground([filename, snapshot = std::move(snapshot), ids = std::move(ids), encoding = So2Encoding::FromSettings()] {
+			Compact(filename, snapshot, ids, encoding);
+			});
+	}
+	static void Compact(const std::string& filename, const ObjectSnapshot& root, const std::vector<size_t>& ids, const So2Encoding& encoding) {
+		auto start = std::chrono::steady_clock::now();
 
-		auto buffer = new char[bufferSize];
-		file.read(buffer, bufferSize);
+		auto data = EncodeBinary(root, encoding);
 
+		auto header = obstream();
+		header.put(ChangeJournal::magic);
+		header.put(data.size());
+		header.put(Hash(data.data(), data.size()));
+		header.putArray(ids);
+
+		// If we crash between these two writes the old journal
+		// won't match the new scene file and will be ignored.
+		WriteAtomic(filename, data.data(), data.size());
+		WriteAtomic(ChangeJournal::GetFileName(filename), header.getBuffer(), header.getSize());
+
+		changeJournal().baseBytes = data.size();
+		changeJournal().journalBytes = header.getSize();
+
+		LastSaveBytes() = data.size() + header.getSize();
+		LastSaveDurationMicroseconds() = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	static void CollectChanges(
+		SceneObject* o,
+		size_t parentId,
+		size_t index,
+		std::unordered_set<size_t>& ids,
+		std::vector<ChangeJournal::Record>& records) {
+		ids.insert(o->Id());
+
+		if (o->ShouldSaveChanges()) {
+			records.push_back({ o->Id(), parentId, index, ObjectSnapshot::TakeWithoutChildren(*o) });
+			o->ResetShouldSaveChanges();
+		}
+
+		// Cross is not saved.
+		size_t i = 0;
+		for (auto c : o->children)
+			if (c->GetType() != CrossT)
+				CollectChanges(c, o->Id(), i++, ids, records);
+	}
+	// Appends objects changed since the last save to the journal.
+	static bool StartAppend(SceneObject* root) {
+		auto& journal = changeJournal();
+		if (backgroundSave().isRunning) {
+			GetLog().Warning("Previous background save is still running. Skipping save.");
+			return false;
+		}
+
+		std::unordered_set<size_t> ids;
+		std::vector<ChangeJournal::Record> records;
+		CollectChanges(root, ChangeJournal::noParent, 0, ids, records);
+
+		std::vector<size_t> deleted;
+		for (auto id : journal.savedIds)
+			if (ids.find(id) == ids.end())
+				deleted.push_back(id);
+
+		journal.savedIds = std::move(ids);
+
+		if (records.empty() && deleted.empty())
+			return true;
+
+		journal.batchCount++;
+		return RunInBackground([filename = journal.filename, records = std::move(records), deleted = std::move(deleted)] {
+			Append(filename, records, deleted);
+			});
+	}
+	static void Append(const std::string& filename, const std::vector<ChangeJournal::Record>& records, const std::vector<size_t>& deleted) {
+		auto start = std::chrono::steady_clock::now();
+
+		auto payload = obstream();
+		payload.putArray(deleted);
+		payload.put(records.size());
+		for (auto& r : records) {
+			payload.put(r.id);
+			payload.put(r.parentId);
+			payload.put(r.index);
+			payload.put(r.object);
+		}
+
+		auto header = obstream();
+		header.put(payload.getSize());
+		header.put(Hash(payload.getBuffer(), payload.getSize()));
+
+		{
+			std::ofstream file(ChangeJournal::GetFileName(filename), std::ios::binary | std::ios::out | std::ios::app);
+			file.write(header.getBuffer(), header.getSize());
+			file.write(payload.getBuffer(), payload.getSize());
+			file.flush();
+
+			if (!file)
+				Fail("Failed to append to change journal");
+		}
+
+		changeJournal().journalBytes += header.getSize() + payload.getSize();
+
+		LastSaveBytes() = header.getSize() + payload.getSize();
+		LastSaveDurationMicroseconds() = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Detaches the object from its parent without marking it as changed.
+	static void Detach(SceneObject* o) {
+		o->SetParent(nullptr, false, false, false, false);
+	}
+	static void ReplayBatch(char* payload, std::map<size_t, SceneObject*>& objects, std::vector<SceneObject*>& removed) {
 		ibstream str;
-		str.setBuffer(buffer);
+		str.setBuffer(payload);
+
+		auto deletedCount = str.get<size_t>();
+		for (size_t i = 0; i < deletedCount; i++)
+			if (auto o = objects.find(str.get<size_t>()); o != objects.end()) {
+				Detach(o->second);
+				removed.push_back(o->second);
+				objects.erase(o);
+			}
+
+		struct Record {
+			size_t id;
+			size_t parentId;
+			size_t index;
+			SceneObject* object;
+		};
+		std::vector<Record> records(str.get<size_t>());
+		for (auto& r : records) {
+			r.id = str.get<size_t>();
+			r.parentId = str.get<size_t>();
+			r.index = str.get<size_t>();
+			r.object = str.get<SceneObject*>();
+		}
+
+		// Detach all changed objects first so recorded positions
+		// refer to the final order of children.
+		for (auto& r : records)
+			if (auto o = objects.find(r.id); o != objects.end())
+				Detach(o->second);
+
+		for (auto& r : records) {
+			if (auto o = objects.find(r.id); o != objects.end()) {
+				// Children that didn't change stay with the new version of the object.
+				for (auto c : std::vector<SceneObject*>(o->second->children))
+					c->SetParent(r.object, false, false, false);
 
-		auto o = str.get<SceneObject*>();
-		inScene->root() = o;
+				removed.push_back(o->second);
+			}
+			objects[r.id] = r.object;
+
+			if (r.parentId == ChangeJournal::noParent)
+				continue;
+
+			auto parent = objects.find(r.parentId);
+			if (parent == objects.end())
+				Fail("Change journal references an unknown object");
+
+			auto& siblings = parent->second->children;
+			r.object->SetParent(parent->second, false, true, false, false);
+			siblings.insert(siblings.begin() + std::min(r.index, siblings.size()), r.object);
+		}
+	}
+	// Replays the journal over its scene file and writes the result to the scene file.
+	static void RecoverJournal(const std::string& filename) {
+		auto journalFilename = ChangeJournal::GetFileName(filename);
+		auto journal = ReadBinary(journalFilename);
+		auto base = ReadBinary(filename);
+
+		size_t offset = sizeof(uint32_t) + sizeof(size_t) + sizeof(uint64_t) + sizeof(size_t);
+		if (journal.size() < offset)
+			Fail("Change journal is corrupted");
+
+		ibstream header;
+		header.setBuffer(journal.data());
+		if (header.get<uint32_t>() != ChangeJournal::magic)
+			Fail("Change journal is corrupted");
+
+		auto baseSize = header.get<size_t>();
+		auto baseHash = header.get<uint64_t>();
+		if (baseSize != base.size() || baseHash != Hash(base.data(), base.size())) {
+			// The scene file was saved in full after the journal was started.
+			fs::remove(journalFilename);
+			return;
+		}
+
+		std::vector<size_t> ids(header.get<size_t>());
+		offset += ids.size() * sizeof(size_t);
+		if (ids.empty() || journal.size() < offset)
+			Fail("Change journal is corrupted");
+		for (auto& id : ids)
+			id = header.get<size_t>();
+
+		std::vector<SceneObject*> baseObjects;
+		auto root = DecodeBinary(base.data(), base.size(), baseObjects);
+		if (baseObjects.size() + 1 != ids.size())
+			Fail("Change journal doesn't match the scene file");
+
+		std::map<size_t, SceneObject*> objects;
+		objects[ids[0]] = root;
+		for (size_t i = 0; i < baseObjects.size(); i++)
+			objects[ids[i + 1]] = baseObjects[i];
+
+		std::vector<SceneObject*> removed;
+		size_t batchCount = 0;
+		const size_t batchHeaderSize = sizeof(size_t) + sizeof(uint64_t);
+		while (offset + batchHeaderSize <= journal.size()) {
+			ibstream batchHeader;
+			batchHeader.setBuffer(journal.data() + offset);
+			auto size = batchHeader.get<size_t>();
+			auto hash = batchHeader.get<uint64_t>();
+
+			// The last batch may be partially written.
+			auto payload = journal.data() + offset + batchHeaderSize;
+			if (size > journal.size() - offset - batchHeaderSize || Hash(payload, size) != hash)
+				break;
+
+			ReplayBatch(payload, objects, removed);
+			offset += batchHeaderSize + size;
+			batchCount++;
+		}
+
+		root = objects[ids[0]];
+		SaveBinary(filename, ObjectSnapshot::Take(*root), So2Encoding::FromSettings());
+		fs::remove(journalFilename);
+
+		root->CallRecursive([&removed](SceneObject* o) { removed.push_back(o); });
+		for (auto o : removed)
+			delete o;
+
+		GetLog().Information("Recovered ", batchCount, " autosaves of ", filename);
+	}
+	static void LoadBinary(std::string filename, Scene* inScene) {
+		auto buffer = ReadBinary(filename);
+
+		std::vector<SceneObject*> objects;
+		inScene->root() = DecodeBinary(buffer.data(), buffer.size(), objects);
 
 		std::vector<PON> newObjects;
-		for (auto o : str.objects)
+		for (auto o : objects)
 			newObjects.push_back(o);
 
 		inScene->Objects() = newObjects;
+	}
+
+	// Line sets of other programs.
+	// Each imported object becomes a child of a group named after the file.
+	static void LoadLines(std::string filename, Scene* inScene, const std::string& extension) {
+		std::ifstream file(filename, std::ios::binary | std::ios::in);
+		if (!file.is_open())
+			Fail("Failed to open file");
+
+		auto name = fs::path(filename).stem().string();
+		auto lines = extension == FileType::Obj
+			? ObjImporter::Import(file, name)
+			: CsvPolylineImporter::Import(file);
+
+		auto root = new GroupObject();
+		root->Name = name;
+
+		std::vector<PON> newObjects = { root };
+		for (auto& l : lines.objects) {
+			SceneObject* o;
+			if (l.isPolyline) {
+				auto polyline = new PolyLine();
+				polyline->SetVertices(std::move(l.vertices));
+				o = polyline;
+			}
+			else {
+				auto mesh = new Mesh();
+				mesh->SetVertices(std::move(l.vertices));
+				mesh->SetConnections(std::move(l.connections));
+				o = mesh;
+			}
+
+			if (!l.name.empty())
+				o->Name = l.name;
+			o->SetParent(root);
+			newObjects.push_back(o);
+		}
 
-		delete[] buffer;
-		file.close();
+		inScene->root() = root;
+		inScene->Objects() = newObjects;
 	}
 
 	static std::string GetFixedExtension(std::string& filename) {
@@ -672,21 +1432,103 @@ public:
 			LoadJson(filename, inScene);
 		else if (extension == FileType::So2)
 			LoadBinary(filename, inScene);
+		else if (extension == FileType::Obj || extension == FileType::Csv)
+			LoadLines(filename, inScene, extension);
 		else
 			Fail("File extension not supported");
 	}
 	static void Save(std::string filename, Scene* inScene) {
 		auto extension = GetFixedExtension(filename);
 
+		// Don't let a background save write the same file concurrently.
+		backgroundSave().Wait();
+
 		if (extension == FileType::Json)
 			SaveJson(filename, inScene);
 		else if (extension == FileType::So2)
 			SaveBinary(filename, inScene);
 		else
 			Fail("File extension not supported");
+
+		// The full save makes the journal of this file outdated.
+		if (auto& journal = changeJournal(); journal.filename == filename) {
+			journal.shouldCompact = true;
+			std::error_code error;
+			fs::remove(ChangeJournal::GetFileName(filename), error);
+		}
+	}
+
+	// Takes a snapshot of the scene on the calling thread
+	// and writes it to an so2 file on a background thread.
+	// Returns false if the previous background save is still running.
+	static bool SaveAsync(std::string filename, Scene* inScene) {
+		if (auto extension = GetFixedExtension(filename); extension != FileType::So2)
+			Fail("Only so2 files can be saved in background");
+
+		if (backgroundSave().isRunning) {
+			GetLog().Warning("Previous background save is still running. Skipping save.");
+			return false;
+		}
+
+		auto snapshot = ObjectSnapshot::Take(*inScene->root().Get().Get());
+
+		return RunInBackground([filename, snapshot = std::move(snapshot), encoding = So2Encoding::FromSettings()] {
+			SaveBinary(filename, snapshot, encoding);
+			});
+	}
+
+	// Like SaveAsync but appends only objects changed since the last save
+	// to the journal next to the file.
+	// The journal is compacted into the file when it grows larger than the scene
+	// or when the scene is replaced e.g. by loading a file.
+	static bool SaveChangesAsync(std::string filename, Scene* inScene) {
+		if (auto extension = GetFixedExtension(filename); extension != FileType::So2)
+			Fail("Only so2 files can be saved in background");
+
+		auto& journal = changeJournal();
+		auto root = inScene->root().Get().Get();
+
+		if (journal.shouldCompact
+			|| journal.filename != filename
+			|| journal.rootId != root->Id()
+			|| journal.batchCount >= ChangeJournal::maxBatchCount
+			|| journal.journalBytes > journal.baseBytes)
+			return StartCompaction(filename, root);
+
+		return StartAppend(root);
+	}
+
+	// Replays journals left in the directory by sessions that didn't exit properly.
+	static void RecoverJournals(const std::string& directory) {
+		std::error_code error;
+		for (auto& entry : fs::directory_iterator(directory, error)) {
+			if (entry.path().extension() != ".journal")
+				continue;
+
+			auto filename = entry.path().parent_path() / entry.path().stem();
+			try {
+				RecoverJournal(filename.u8string());
+			}
+			catch (FileException* e) {
+				delete e;
+			}
+			catch (std::exception& e) {
+				GetLog().Error("Failed to recover ", filename.u8string(), ": ", e.what());
+			}
+		}
+	}
+
+	// Statistics of the last so2 save.
+	static std::atomic<size_t>& LastSaveDurationMicroseconds() {
+		static std::atomic<size_t> v = 0;
+		return v;
+	}
+	static std::atomic<size_t>& LastSaveBytes() {
+		static std::atomic<size_t> v = 0;
+		return v;
 	}
 
-	static Jw::ObjectAbstract* LoadLocaleFile(const std::string& filename) {
+	static std::unique_ptr<JsonDocument> LoadLocaleFile(const std::string& filename) {
 		return Json::ReadW(filename);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "InfrastructureTypes.hpp"
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+// Tells the main loop whether a frame has to be drawn
+// or it can wait for events because nothing has changed.
+// Changes are reported from any thread.
+class FrameScheduler {
+	using Clock = std::chrono::steady_clock;
+
+	// ImGui needs a few frames after an event to settle hover and layout.
+	static constexpr int framesAfterEvent = 3;
+
+	StaticField(std::atomic<int>, pendingFrames)
+	StaticField(std::atomic<bool>, isSceneChanged)
+	StaticField(std::atomic<bool>, isWaiting)
+
+	// Time spent waiting for events over the last second.
+	StaticField(Clock::time_point, idleWindowStart)
+	StaticField(Clock::duration, idleWindowWaited)
+	StaticField(float, idleFraction)
+
+	static void UpdateIdleFraction() {
+		auto now = Clock::now();
+		if (auto elapsed = now - idleWindowStart(); elapsed >= std::chrono::seconds(1)) {
+			idleFraction() = std::chrono::duration<float>(idleWindowWaited()).count() / std::chrono::duration<float>(elapsed).count();
+			idleWindowStart() = now;
+			idleWindowWaited() = Clock::duration::zero();
+		}
+	}
+
+	static void Wake() {
+		if (isWaiting().load() && WakeMainLoop())
+			WakeMainLoop()();
+	}
+
+public:
+	// Interrupts the main loop waiting for events. Must be thread safe.
+	StaticField(std::function<void()>, WakeMainLoop)
+	// The loop draws a frame this often even if nothing has changed
+	// to keep the status and the text cursor up to date.
+	StaticFieldDefault(float, IdleTimeoutSeconds, 0.5f)
+
+	// The interface has to be redrawn.
+	static void RequestFrame() {
+		pendingFrames().store(framesAfterEvent);
+		Wake();
+	}
+	// The scene has to be redrawn.
+	// Cheap when the change has already been reported this frame.
+	static void RequestRedraw() {
+		if (isSceneChanged().load(std::memory_order_relaxed))
+			return;
+
+		isSceneChanged() = true;
+		Wake();
+	}
+
+	static bool ShouldDrawFrame() {
+		return pendingFrames().load() > 0
+			|| isSceneChanged().load();
+	}
+	// Called by the render window before drawing the scene.
+	// Changes reported after the call are drawn on the next frame.
+	static bool TakeSceneChange() {
+		return isSceneChanged().exchange(false);
+	}
+	// Called at the end of every iteration of the main loop.
+	static void FrameDrawn() {
+		UpdateIdleFraction();
+
+		if (auto v = pendingFrames().load(); v > 0)
+			pendingFrames().compare_exchange_strong(v, v - 1);
+	}
+
+	// Waits up to the idle timeout using the given function.
+	// Returns true if the wait was interrupted by an event or a request.
+	template<typename F>
+	static bool Wait(F wait) {
+		auto start = Clock::now();
+
+		// Requests check isWaiting after they are stored
+		// so one of the two sides always sees the other.
+		isWaiting() = true;
+		if (!ShouldDrawFrame())
+			wait(IdleTimeoutSeconds());
+		isWaiting() = false;
+
+		auto waited = Clock::now() - start;
+		idleWindowWaited() += waited;
+		return waited < std::chrono::duration<float>(IdleTimeoutSeconds());
+	}
+
+	// Share of the time the main loop has spent waiting during the last whole second.
+	static float GetIdleFraction() {
+		return idleFraction();
+	}
+};
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "opencv2/videoio.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Where camera frames come from.
+class FrameSource {
+public:
+	virtual ~FrameSource() {}
+
+	virtual bool Open() = 0;
+	// Blocks until the next frame is available.
+	// Returns false when there are no more frames.
+	virtual bool Read(cv::Mat& frame) = 0;
+
+	// Live camera when the path is empty, otherwise a recording.
+	static std::unique_ptr<FrameSource> Create(const std::string& path, bool isRealTime, bool isLooped);
+};
+
+class CameraFrameSource : public FrameSource {
+	cv::VideoCapture capture;
+	int device;
+
+public:
+	CameraFrameSource(int device = 0) : device(device) {}
+
+	bool Open() override {
+		return capture.open(device);
+	}
+	bool Read(cv::Mat& frame) override {
+		return capture.read(frame) && !frame.empty();
+	}
+};
+
+// Recorded video file or a directory of images ordered by name.
+// Frames can be given at the recorded rate as a camera would
+// or as fast as they are read.
+class ReplayFrameSource : public FrameSource {
+	std::string path;
+	bool isRealTime;
+	bool isLooped;
+
+	cv::VideoCapture video;
+	std::vector<std::filesystem::path> images;
+
+	size_t position = 0;
+	double frameRate = 0;
+	std::chrono::steady_clock::time_point start;
+
+	bool ReadNext(cv::Mat& frame) {
+		if (images.empty())
+			return video.read(frame) && !frame.empty();
+
+		if (position >= images.size())
+			return false;
+
+		frame = cv::imread(images[position].string());
+		return !frame.empty();
+	}
+
+	bool Rewind() {
+		position = 0;
+		start = std::chrono::steady_clock::now();
+		return images.empty()
+			? video.set(cv::CAP_PROP_POS_FRAMES, 0)
+			: true;
+	}
+
+public:
+	// Rate of image directories which don't store it.
+	double imageFrameRate = 30;
+
+	ReplayFrameSource(const std::string& path, bool isRealTime, bool isLooped)
+		: path(path), isRealTime(isRealTime), isLooped(isLooped) {}
+
+	bool Open() override {
+		std::error_code error;
+		if (std::filesystem::is_directory(path, error)) {
+			for (auto& entry : std::filesystem::directory_iterator(path, error))
+				if (entry.is_regular_file())
+					images.push_back(entry.path());
+			std::sort(images.begin(), images.end());
+
+			frameRate = imageFrameRate;
+		}
+		else {
+			if (!video.open(path))
+				return false;
+
+			frameRate = video.get(cv::CAP_PROP_FPS);
+		}
+
+		if (!(frameRate > 0))
+			frameRate = imageFrameRate;
+
+		Rewind();
+		return images.size() > 0 || video.isOpened();
+	}
+
+	// Frames per second of the recording.
+	double FrameRate() const {
+		return frameRate;
+	}
+
+	bool Read(cv::Mat& frame) override {
+		if (!ReadNext(frame)) {
+			if (!isLooped || position == 0 || !Rewind() || !ReadNext(frame))
+				return false;
+		}
+
+		if (isRealTime)
+			std::this_thread::sleep_until(start + std::chrono::duration<double>(position / frameRate));
+
+		position++;
+		return true;
+	}
+};
+
+inline std::unique_ptr<FrameSource> FrameSource::Create(const std::string& path, bool isRealTime, bool isLooped) {
+	if (path.empty())
+		return std::make_unique<CameraFrameSource>();
+
+	return std::make_unique<ReplayFrameSource>(path, isRealTime, isLooped);
+}
@@ -1,7 +1,5 @@
 #pragma once
 #include <imgui/imgui.h>
-#include <imgui/imgui_impl_glfw.h>
-#include <imgui/imgui_impl_opengl3.h>
 #include <string>
 #include <functional>
 #include <vector>
@@ -12,6 +10,17 @@
 //#include <GLFW/glfw3.h>
 //#include <GL/gl3w.h>
 
+// The domain code builds without GL or a window when STEREOPLUS2_HEADLESS is defined.
+// ImGui is still there as it doesn't depend on either.
+#ifdef STEREOPLUS2_HEADLESS
+#include "HeadlessGL.hpp"
+// Key codes only.
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#else
+#include <imgui/imgui_impl_glfw.h>
+#include <imgui/imgui_impl_opengl3.h>
+
 // About Desktop OpenGL function loaders:
 //  Modern desktop OpenGL doesn't have a standard portable header file to load OpenGL function pointers.
 //  Helper libraries are often used for this purpose! Here we are supporting a few common ones (gl3w, glew, glad).
@@ -35,6 +44,7 @@
 #if defined(_MSC_VER) && (_MSC_VER >= 1900) && !defined(IMGUI_DISABLE_WIN32_FUNCTIONS)
 #pragma comment(lib, "legacy_stdio_definitions")
 #endif
+#endif
 
 class GLLoader
 {
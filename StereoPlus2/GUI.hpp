@@ -5,7 +5,11 @@
 #include "Windows.hpp"
 #include "Input.hpp"
 #include "Localization.hpp"
+#include "ExternalPose.hpp"
+#include "Profiler.hpp"
+#include "FrameScheduler.hpp"
 #include <map>
+#include <deque>
 
 
 class GUI {
@@ -16,6 +20,13 @@ class GUI {
 
 	FileWindow* fileWindow = nullptr;
 
+	// Fences of the frames the GPU may not have finished yet.
+	std::deque<GLsync> queuedFrames;
+
+	// Counting every object each frame would show in the frame time.
+	static constexpr auto memoryCountPeriod = std::chrono::milliseconds(500);
+	std::chrono::steady_clock::time_point lastMemoryCount;
+
 	bool CreateFileWindow(FileWindow::Mode mode) {
 		auto fileWindow = new FileWindow();
 
@@ -29,10 +40,10 @@ class GUI {
 
 		this->fileWindow = fileWindow;
 		fileWindow->OnExit().AddHandler([f = &this->fileWindow]{
-			(new FuncCommand())->func = [f = f] {
+			FuncCommand::Post([f = f] {
 				delete* f;
 				*f = nullptr;
-				};
+				});
 			});
 		
 		return true;
@@ -59,12 +70,28 @@ class GUI {
 				scene->DeleteAll();
 
 			if (auto h = Settings::ShouldDetectPosition().Get(); 
-				ImGui::MenuItem(LocaleProvider::GetC("usePositionDetection"), nullptr, &h))
+				ImGui::MenuItem(
+					LocaleProvider::GetC("usePositionDetection"),
+					ReadOnlyState::PositionDetectionStatus().Get().empty()
+						? nullptr
+						: LocaleProvider::GetC("positionDetectionStatus:" + ReadOnlyState::PositionDetectionStatus().Get()),
+					&h))
 				Settings::ShouldDetectPosition() = h;
+			if (ImGui::BeginMenu(LocaleProvider::GetC("poseProvider"))) {
+				for (auto& provider : { PoseProvider::Camera, PoseProvider::Udp, PoseProvider::SharedMemory })
+					if (ImGui::MenuItem(LocaleProvider::GetC("webcam:" + provider), nullptr, Settings::PoseProvider().Get() == provider))
+						Settings::PoseProvider() = provider;
+
+				ImGui::EndMenu();
+			}
 			ImGui::MenuItem(LocaleProvider::GetC("showFPS"), nullptr, &shouldShowFPS);
 
 			if (ImGui::MenuItem(LocaleProvider::GetC("settings"), nullptr, false))
 				settingsWindow->IsOpen = true;
+			if (ImGui::MenuItem(LocaleProvider::GetC("profilerWindow"), nullptr, false))
+				profilerWindow->IsOpen = true;
+			if (ImGui::MenuItem(LocaleProvider::GetC("memoryWindow"), nullptr, false))
+				memoryWindow->IsOpen = true;
 
 			if (ImGui::MenuItem(LocaleProvider::GetC("exit"), nullptr, false))
 				shouldClose = true;
@@ -83,6 +110,14 @@ class GUI {
 
 		if (shouldShowFPS) {
 			ImGui::LabelText("", "FPS: %-12i DeltaTime: %-12f", Time::GetAverageFrameRate(), Time::GetAverageDeltaTime());
+
+			if (Settings::IsRenderOnDemandEnabled().Get())
+				ImGui::LabelText("", "%s: %.0f%%", LocaleProvider::GetC("idle"), FrameScheduler::GetIdleFraction() * 100);
+
+			if (Settings::ShouldDetectPosition().Get())
+				ImGui::LabelText("", "%s: %.1f ms", LocaleProvider::GetC("poseLatency"), ReadOnlyState::PoseLatencyMilliseconds().Get());
+
+			ImGui::LabelText("", "%s: %s", LocaleProvider::GetC("memoryUsage"), MemoryUsage::Format(MemoryUsage::GetTotal()).c_str());
 		}
 
 		return true;
@@ -137,6 +172,56 @@ class GUI {
 		return true;
 	}
 
+	// Waits until no more than the allowed number of frames is left for the GPU
+	// so the frames don't pile up and delay the newest pose.
+	void LimitQueuedFrames() {
+		auto maxQueuedFrames = (size_t)Settings::MaxQueuedFrames().Get();
+		if (maxQueuedFrames > 0)
+			queuedFrames.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+		while (queuedFrames.size() > maxQueuedFrames) {
+			// A second at most so a lost context can't hang the loop.
+			glClientWaitSync(queuedFrames.front(), GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+			glDeleteSync(queuedFrames.front());
+			queuedFrames.pop_front();
+		}
+	}
+
+	void CountMemory() {
+		if (auto now = std::chrono::steady_clock::now(); now - lastMemoryCount > memoryCountPeriod) {
+			lastMemoryCount = now;
+
+			PROFILE_SCOPE("Scene::CountMemory");
+			Scene::CountMemory();
+		}
+	}
+
+	void LogLatency() {
+		auto& total = MotionToPhotonLatency::Total();
+		if (total.GetCount() == 0)
+			return;
+
+		log.Information("Motion-to-photon latency over ", total.GetCount(), " poses: p50 ", total.GetPercentile(50),
+			" ms, p90 ", total.GetPercentile(90), " ms, p99 ", total.GetPercentile(99), " ms, max ", total.GetMax(), " ms");
+	}
+
+	// Events that have reached ImGui since the last frame.
+	static bool HasInput(const ImGuiIO& io) {
+		if (io.MouseDelta.x != 0 || io.MouseDelta.y != 0
+			|| io.MouseWheel != 0 || io.MouseWheelH != 0
+			|| !io.InputQueueCharacters.empty())
+			return true;
+
+		for (auto down : io.MouseDown)
+			if (down)
+				return true;
+		for (auto down : io.KeysDown)
+			if (down)
+				return true;
+
+		return false;
+	}
+
 #pragma endregion
 public:
 	// It seems to be garbage collected or something.
@@ -149,11 +234,15 @@ public:
 	Scene* scene;
 
 	SettingsWindow* settingsWindow;
+	ProfilerWindow* profilerWindow;
+	MemoryWindow* memoryWindow;
 
 	bool shouldShowFPS = true;
 
 	std::vector<Window*> windows;
 	std::function<bool()> customRenderFunc;
+	// Draws the scene in low latency mode once the interface has been laid out.
+	std::function<bool()> lateRenderFunc;
 	std::function<void()> renderViewport;
 	std::function<void()> renderAdvanced;
 
@@ -220,6 +309,8 @@ public:
 		//ImFont* font = io.Fonts->AddFontFromFileTTF("open-sans.ttf", 20);
 		//IM_ASSERT(font != NULL);
 
+		FrameScheduler::WakeMainLoop() = glfwPostEmptyEvent;
+
 		input.io() = io;
 		if (!input.Init() ||
 			!keyBinding.Init())
@@ -234,6 +325,8 @@ public:
 
 	bool Design()
 	{
+		PROFILE_SCOPE("GUI::Design");
+
 		// Show main window docking space
 		if (!DesignMainWindowDockingSpace())
 			return false;
@@ -255,14 +348,29 @@ public:
 	}
 
 	bool MainLoop() {
+		PROFILE_THREAD("main");
+
 		// Main loop
 		while (!glfwWindowShouldClose(glWindow)) {
+			PROFILE_SCOPE(Profiler::frameName);
+
 			// Poll and handle events (inputs, window resize, etc.)
 			// You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
 			// - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application.
 			// - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application.
 			// Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-			glfwPollEvents();
+			// When nothing has changed wait for events instead.
+			// Waking up early means there was an event
+			// unless the wake up was a request for a frame.
+			if (Settings::IsRenderOnDemandEnabled().Get() && !FrameScheduler::ShouldDrawFrame()) {
+				PROFILE_SCOPE("glfwWaitEventsTimeout");
+				if (FrameScheduler::Wait([](float timeout) { glfwWaitEventsTimeout(timeout); }) && !FrameScheduler::ShouldDrawFrame())
+					FrameScheduler::RequestFrame();
+			}
+			else {
+				PROFILE_SCOPE("glfwPollEvents");
+				glfwPollEvents();
+			}
 			input.ProcessInput();
 
 			// Start the Dear ImGui frame
@@ -270,6 +378,10 @@ public:
 			ImGui_ImplGlfw_NewFrame();
 			ImGui::NewFrame();
 
+			// Input is handled over the next frames.
+			if (HasInput(*io))
+				FrameScheduler::RequestFrame();
+
 			if (!Design())
 				return false;
 
@@ -277,29 +389,59 @@ public:
 				return true;
 
 			// Rendering
-			ImGui::Render();
-			int display_w, display_h;
-			glfwGetFramebufferSize(glWindow, &display_w, &display_h);
-			glViewport(0, 0, display_w, display_h);
-			glClear(GL_COLOR_BUFFER_BIT);
-			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-			// Update and Render additional Platform Windows
-			// (Platform functions may change the current OpenGL context, so we save/restore it to make it easier to paste this code elsewhere.
-			//  For this specific demo app we could also call glfwMakeContextCurrent(window) directly)
-			if (io->ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
-				GLFWwindow* backup_current_context = glfwGetCurrentContext();
-				ImGui::UpdatePlatformWindows();
-				ImGui::RenderPlatformWindowsDefault();
-				glfwMakeContextCurrent(backup_current_context);
+			{
+				PROFILE_SCOPE("GUI::Render");
+				ImGui::Render();
+
+				// The newest pose is taken as late as possible.
+				// ImGui only reads the scene texture when its draw data is rendered below.
+				if (Settings::IsLowLatencyModeEnabled().Get() && lateRenderFunc) {
+					PROFILE_SCOPE("GUI::LateRender");
+					if (!lateRenderFunc())
+						return false;
+				}
+
+				int display_w, display_h;
+				glfwGetFramebufferSize(glWindow, &display_w, &display_h);
+				glViewport(0, 0, display_w, display_h);
+				glClear(GL_COLOR_BUFFER_BIT);
+				ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+				// Update and Render additional Platform Windows
+				// (Platform functions may change the current OpenGL context, so we save/restore it to make it easier to paste this code elsewhere.
+				//  For this specific demo app we could also call glfwMakeContextCurrent(window) directly)
+				if (io->ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+					GLFWwindow* backup_current_context = glfwGetCurrentContext();
+					ImGui::UpdatePlatformWindows();
+					ImGui::RenderPlatformWindowsDefault();
+					glfwMakeContextCurrent(backup_current_context);
+				}
 			}
 
-			glfwSwapBuffers(glWindow);
+			{
+				PROFILE_SCOPE("glfwSwapBuffers");
+				glfwSwapBuffers(glWindow);
+			}
+			StartupTimer::FirstFrameDrawn();
 
-			if (!Command::ExecuteAll())
-				return false;
+			if (auto latency = MotionToPhotonLatency::FrameSwapped())
+				ReadOnlyState::PoseLatencyMilliseconds() = *latency;
+
+			{
+				PROFILE_SCOPE("GUI::LimitQueuedFrames");
+				LimitQueuedFrames();
+			}
+
+			{
+				PROFILE_SCOPE("Command::ExecuteAll");
+				if (!Command::ExecuteAll())
+					return false;
+			}
+
+			CountMemory();
 
 			Time::UpdateFrame();
+			FrameScheduler::FrameDrawn();
 			//std::cout << "FPS: " << Time::GetFrameRate() << std::endl;
 		}
 
@@ -312,6 +454,13 @@ public:
 			if (!window->Exit())
 				return false;
 		
+		LogLatency();
+		log.Information("Peak memory usage: ", MemoryUsage::Format(MemoryUsage::GetTotalPeak()));
+
+		for (auto fence : queuedFrames)
+			glDeleteSync(fence);
+		queuedFrames.clear();
+
 		// Cleanup
 		ImGui_ImplOpenGL3_Shutdown();
 		ImGui_ImplGlfw_Shutdown();
@@ -0,0 +1,54 @@
+#pragma once
+
+// OpenGL types and constants without a loader.
+#include <GL/glcorearb.h>
+
+// Stands in for the OpenGL functions the domain code calls
+// so scenes can be built, edited, saved and loaded without a GL context,
+// e.g. by the benchmarks on build servers.
+// Buffers get no names and nothing is drawn.
+
+inline void glGenBuffers(GLsizei n, GLuint* buffers) {
+	for (GLsizei i = 0; i < n; i++)
+		buffers[i] = 0;
+}
+inline void glGenVertexArrays(GLsizei n, GLuint* arrays) {
+	for (GLsizei i = 0; i < n; i++)
+		arrays[i] = 0;
+}
+inline void glDeleteBuffers(GLsizei, const GLuint*) {}
+inline void glBindBuffer(GLenum, GLuint) {}
+inline void glBufferData(GLenum, GLsizeiptr, const void*, GLenum) {}
+inline void glVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*) {}
+inline void glEnableVertexAttribArray(GLuint) {}
+inline void glDrawArrays(GLenum, GLint, GLsizei) {}
+inline void glDrawElements(GLenum, GLsizei, GLenum, const void*) {}
+inline void glUseProgram(GLuint) {}
+
+// Shaders compile successfully into nothing.
+inline GLuint glCreateShader(GLenum) {
+	return 0;
+}
+inline void glShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*) {}
+inline void glCompileShader(GLuint) {}
+inline void glGetShaderiv(GLuint, GLenum, GLint* params) {
+	*params = GL_TRUE;
+}
+inline void glGetShaderInfoLog(GLuint, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	if (length)
+		*length = 0;
+	if (bufSize > 0)
+		infoLog[0] = 0;
+}
+inline GLuint glCreateProgram() {
+	return 0;
+}
+inline void glAttachShader(GLuint, GLuint) {}
+inline void glLinkProgram(GLuint) {}
+inline void glGetProgramiv(GLuint, GLenum, GLint* params) {
+	*params = GL_TRUE;
+}
+inline void glGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	glGetShaderInfoLog(program, bufSize, length, infoLog);
+}
+inline void glDeleteShader(GLuint) {}
@@ -10,12 +10,21 @@
 #include <set>
 #include <functional>
 #include <map>
+#include <list>
+#include <cmath>
+#include <algorithm>
+#include <new>
+#include <memory>
+#include <type_traits>
 #include <glm/vec3.hpp>
 
 #include <fstream>
 #include <filesystem>// C++17 standard header file name
 
 #include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 namespace fs = std::filesystem;
 
 template<typename T>
@@ -203,8 +212,10 @@ public:
 		return v;
 	}
 	static std::string GetTimeFormatted(const std::string& format = "%Y-%m-%d %H:%M:%S") {
-		std::chrono::system_clock::time_point now = std::chrono::system_clock::now();
-		std::time_t now_c = std::chrono::system_clock::to_time_t(now);
+		return GetTimeFormatted(std::chrono::system_clock::now(), format);
+	}
+	static std::string GetTimeFormatted(std::chrono::system_clock::time_point time, const std::string& format = "%Y-%m-%d %H:%M:%S") {
+		std::time_t now_c = std::chrono::system_clock::to_time_t(time);
 
 #pragma warning(push)
 #pragma warning(disable: 4996)
@@ -218,8 +229,90 @@ public:
 
 };
 
+// Bounded lock-free queue any thread can push to and pop from.
+// A slot's sequence tells whether it is free for the push
+// or filled for the pop of the current lap around the slots.
+template<typename T>
+class AtomicQueue {
+	struct Slot {
+		std::atomic<size_t> sequence;
+		T value;
+	};
+	std::unique_ptr<Slot[]> slots;
+	size_t mask;
+	std::atomic<size_t> pushPosition = 0;
+	std::atomic<size_t> popPosition = 0;
+
+public:
+	// Capacity is rounded up to a power of two.
+	AtomicQueue(size_t capacity) {
+		size_t size = 1;
+		while (size < capacity)
+			size *= 2;
+
+		slots = std::make_unique<Slot[]>(size);
+		mask = size - 1;
+		for (size_t i = 0; i < size; i++)
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// The value is moved from only if there was room for it.
+	bool TryPush(T& v) {
+		auto position = pushPosition.load(std::memory_order_relaxed);
+		while (true) {
+			auto& slot = slots[position & mask];
+			auto difference = (ptrdiff_t)slot.sequence.load(std::memory_order_acquire) - (ptrdiff_t)position;
+
+			if (difference == 0) {
+				if (pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					slot.value = std::move(v);
+					slot.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+				return false;
+			else
+				position = pushPosition.load(std::memory_order_relaxed);
+		}
+	}
+	bool TryPop(T& v) {
+		auto position = popPosition.load(std::memory_order_relaxed);
+		while (true) {
+			auto& slot = slots[position & mask];
+			auto difference = (ptrdiff_t)slot.sequence.load(std::memory_order_acquire) - (ptrdiff_t)(position + 1);
+
+			if (difference == 0) {
+				if (popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					v = std::move(slot.value);
+					slot.sequence.store(position + mask + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+				return false;
+			else
+				position = popPosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	size_t GetCapacity() const {
+		return mask + 1;
+	}
+	// Approximate while other threads push or pop.
+	size_t GetSize() const {
+		return pushPosition.load(std::memory_order_relaxed) - popPosition.load(std::memory_order_relaxed);
+	}
+};
+
 class Log {
 public:
+	enum class Level {
+		Information,
+		Warning,
+		Error,
+		None,
+	};
 	struct Context {
 		std::string contextName = "";
 		std::string logFileName = "";
@@ -233,6 +326,140 @@ private:
 	template<typename T>
 	static constexpr bool isOstreamableT = is_detected_v<isOstreamable, T>;
 
+	// Writes the messages in batches on a background thread
+	// keeping the log files open between the batches.
+	class Writer {
+		static constexpr size_t capacity = 4096;
+		static constexpr auto period = std::chrono::milliseconds(50);
+
+		struct Entry {
+			bool isConsole = false;
+			std::chrono::system_clock::time_point time;
+			Context context;
+		};
+
+		AtomicQueue<Entry> queue = AtomicQueue<Entry>(capacity);
+		std::map<std::string, std::ofstream> files;
+
+		std::mutex mutex;
+		std::condition_variable hasEntries;
+		std::atomic<bool> isStopRequested = false;
+		std::thread thread;
+
+		static Path& LogDirectory() {
+			static Path v("logs/");
+			return v;
+		}
+		static const std::string& StartTime() {
+			static std::string v = Time::GetTimeFormatted("%Y%m%d%H%M%S");
+			return v;
+		}
+		static std::ofstream& GetFile(std::map<std::string, std::ofstream>& files, const std::string& logFileName) {
+			auto& f = files[logFileName];
+			if (!f.is_open()) {
+				if (!fs::is_directory(LogDirectory().get()) || !fs::exists(LogDirectory().get()))
+					fs::create_directory(LogDirectory().get());
+
+				f.open(LogDirectory().joinPath(logFileName + StartTime()), std::ios_base::app);
+			}
+			return f;
+		}
+		static void Write(std::vector<Entry>& batch, std::map<std::string, std::ofstream>& files) {
+			std::string console;
+			std::map<std::string, std::string> texts;
+
+			// Messages logged within the same second share the time text.
+			std::time_t lastTime = 0;
+			std::string lastTimeText;
+
+			for (auto& e : batch) {
+				auto& c = e.context;
+				auto line = "[" + c.level + "](" + c.contextName + ")" + c.message + "\n";
+
+				if (e.isConsole) {
+					console += line;
+					continue;
+				}
+
+				if (auto time = std::chrono::system_clock::to_time_t(e.time); time != lastTime || lastTimeText.empty()) {
+					lastTime = time;
+					lastTimeText = Time::GetTimeFormatted(e.time);
+				}
+				texts[c.logFileName] += lastTimeText + line;
+			}
+
+			if (!console.empty())
+				std::cout << console << std::flush;
+			for (auto& [logFileName, text] : texts)
+				GetFile(files, logFileName) << text << std::flush;
+		}
+
+		void Process() {
+			std::vector<Entry> batch;
+			Entry e;
+			while (true) {
+				// Woken early when the queue fills up or on stop.
+				if (!isStopRequested) {
+					std::unique_lock lock(mutex);
+					hasEntries.wait_for(lock, period);
+				}
+				// Everything pushed before the stop request is written.
+				auto isStopping = isStopRequested.load();
+
+				while (queue.TryPop(e))
+					batch.push_back(std::move(e));
+				Write(batch, files);
+				batch.clear();
+
+				if (isStopping)
+					return;
+			}
+		}
+
+	public:
+		Writer() {
+			// Constructed first so they outlive the writer's last batch.
+			LogDirectory();
+			StartTime();
+			thread = std::thread([this] { Process(); });
+		}
+		~Writer() {
+			IsClosed() = true;
+			isStopRequested = true;
+			hasEntries.notify_one();
+			thread.join();
+		}
+
+		// Static objects destroyed after the writer still log synchronously.
+		static bool& IsClosed() {
+			static bool v = false;
+			return v;
+		}
+		static Writer& Get() {
+			static Writer v;
+			return v;
+		}
+
+		static void Push(bool isConsole, const Context& c) {
+			Entry e{ isConsole, std::chrono::system_clock::now(), c };
+
+			if (IsClosed()) {
+				std::vector<Entry> batch{ std::move(e) };
+				std::map<std::string, std::ofstream> files;
+				Write(batch, files);
+				return;
+			}
+
+			auto& w = Get();
+			// When the queue is full wait for the writer rather than lose the message.
+			while (!w.queue.TryPush(e)) {
+				w.hasEntries.notify_one();
+				std::this_thread::yield();
+			}
+			if (w.queue.GetSize() > capacity / 2)
+				w.hasEntries.notify_one();
+		}
+	};
 
 	Context context;
 	std::function<void(const Context&)> sink = Sink();
@@ -243,12 +470,25 @@ private:
 		ss << message;
 		return ss.str();
 	}
+	static std::string ToString(const char* message) {
+		return message;
+	}
+	static const std::string& ToString(const std::string& message) {
+		return message;
+	}
 	static std::string ToString(const glm::vec3& message) {
 		std::ostringstream ss;
 		ss << "(" << message.x << ";" << message.y << ";" << message.z << ")";
 		return ss.str();
 	}
 
+	void Write(const char* level, const std::string& message) const {
+		Context c = context;
+		c.level = level;
+		c.message = message;
+		sink(c);
+	}
+
 public:
 	template<typename T>
 	static const Log For(std::string logFileName = LogFileName(), std::function<void(const Context&)> sink = Sink()) {
@@ -259,37 +499,43 @@ public:
 		return log;
 	}
 
+	// Messages below the level are dropped before they are formatted.
+	static std::atomic<Level>& MinLevel() {
+		static std::atomic<Level> v = Level::Information;
+		return v;
+	}
+	static bool IsEnabled(Level level) {
+		return level >= MinLevel().load(std::memory_order_relaxed);
+	}
+
 	template<typename... T>
 	void Error(const T&... message) const {
-		Error((Log::ToString(message) + ...));
+		if (IsEnabled(Level::Error))
+			Write("Error", (Log::ToString(message) + ...));
 	}
 	template<typename... T>
 	void Warning(const T&... message) const {
-		Warning((Log::ToString(message) + ...));
+		if (IsEnabled(Level::Warning))
+			Write("Warning", (Log::ToString(message) + ...));
 	}
 	template<typename... T>
 	void Information(const T&... message) const {
-		Information((Log::ToString(message) + ...));
+		if (IsEnabled(Level::Information))
+			Write("Information", (Log::ToString(message) + ...));
 	}
 
 
 	void Error(const std::string& message) const {
-		Context c = context;
-		c.level = "Error";
-		c.message = message;
-		sink(c);
+		if (IsEnabled(Level::Error))
+			Write("Error", message);
 	}
 	void Warning(const std::string& message) const {
-		Context c = context;
-		c.level = "Warning";
-		c.message = message;
-		sink(c);
+		if (IsEnabled(Level::Warning))
+			Write("Warning", message);
 	}
 	void Information(const std::string& message) const {
-		Context c = context;
-		c.level = "Information";
-		c.message = message;
-		sink(c);
+		if (IsEnabled(Level::Information))
+			Write("Information", message);
 	}
 
 	static std::string& LogFileName() {
@@ -301,31 +547,62 @@ public:
 		return v;
 	}
 
+	// Both sinks only queue the message for the writer thread.
 	static void FileSink(const Context& v) {
-		static Path logDirectory("logs/");
-		static std::string startTime = Time::GetTimeFormatted("%Y%m%d%H%M%S");
-		if (!fs::is_directory(logDirectory.get()) || !fs::exists(logDirectory.get()))
-			fs::create_directory(logDirectory.get());
-
-		std::stringstream ss;
-		ss << Time::GetTimeFormatted() << "[" << v.level << "]" << "(" << v.contextName << ")" << v.message << std::endl;
-		auto log = ss.str();
-
-		std::ofstream f(logDirectory.joinPath(v.logFileName + startTime), std::ios_base::app);
-		f << log;
-		f.close();
+		Writer::Push(false, v);
 	}
 	static void ConsoleSink(const Context& v) {
-		std::cout << "[" << v.level << "]" << "(" << v.contextName << ")" << v.message << std::endl;
+		Writer::Push(true, v);
+	}
+};
+
+// Lock-free stack of intrusively linked items.
+// Any thread can push but items are only taken all at once
+// which leaves no room for the ABA problem.
+template<typename T>
+class AtomicStack {
+	std::atomic<T*> head = nullptr;
+public:
+	void Push(T* item) {
+		item->next = head.load(std::memory_order_relaxed);
+		while (!head.compare_exchange_weak(item->next, item, std::memory_order_release, std::memory_order_relaxed));
+	}
+	// Returns the items linked from the last pushed one.
+	T* TakeAll() {
+		return head.exchange(nullptr, std::memory_order_acquire);
+	}
+	bool IsEmpty() const {
+		return head.load(std::memory_order_relaxed) == nullptr;
 	}
 };
 
 class Command {
-	static std::list<Command*>& GetQueue() {
-		static auto queue = std::list<Command*>();
+	friend class AtomicStack<Command>;
+
+	// Commands created since the last execution.
+	// Commands are pushed from any thread and taken by ExecuteAll.
+	static AtomicStack<Command>& GetQueue() {
+		static AtomicStack<Command> queue;
 		return queue;
 	}
+	// Commands that are persistent or not ready yet.
+	static std::vector<Command*>& GetRetained() {
+		static std::vector<Command*> retained;
+		return retained;
+	}
+
+	// Appends the queued commands in the order they were created.
+	static void TakeQueued(std::vector<Command*>& commands) {
+		auto first = commands.size();
+		for (auto c = GetQueue().TakeAll(); c; c = c->next)
+			commands.push_back(c);
+		std::reverse(commands.begin() + first, commands.end());
+	}
+
 protected:
+	// Link in the queue or a pool.
+	Command* next = nullptr;
+
 	bool isReady = false;
 	// Defines wether command must be deleted after execution.
 	// false = will be deleted. 
@@ -334,32 +611,95 @@ protected:
 	// until mustPersist is set to false.
 	bool mustPersist = false;
 	virtual bool Execute() = 0;
+	// Called once the command is done.
+	virtual void Retire() {
+		delete this;
+	}
+
+	struct Unqueued {};
+	// For commands that are queued with Enqueue when they are set up.
+	Command(Unqueued) {}
+	void Enqueue() {
+		GetQueue().Push(this);
+	}
+
 public:
+	// Commands created this way are queued at once
+	// so they have to be set up on the main thread before ExecuteAll runs.
+	// Other threads use FuncCommand::Post.
 	Command() {
-		GetQueue().push_back(this);
+		Enqueue();
 	}
+	virtual ~Command() {}
+
+	// Runs on the main thread once a frame.
+	// Commands created during the execution are executed in the same call.
 	static bool ExecuteAll() {
-		std::list<Command*> deleteQueue;
-		for (auto command : GetQueue())
-			if (command->isReady) {
-				if (!command->Execute())
-					return false;
-
-				if (!command->mustPersist)
-					deleteQueue.push_back(command);
+		auto& commands = GetRetained();
+		size_t kept = 0;
+
+		for (size_t i = 0; TakeQueued(commands), i < commands.size();)
+			for (; i < commands.size(); i++) {
+				auto command = commands[i];
+				if (command->isReady) {
+					if (!command->Execute()) {
+						// Leave the rest for the next call.
+						commands.erase(commands.begin() + kept, commands.begin() + i);
+						return false;
+					}
+
+					if (!command->mustPersist) {
+						command->Retire();
+						continue;
+					}
+				}
+
+				commands[kept++] = command;
 			}
 
-		for (auto command : deleteQueue) {
-			GetQueue().remove(command);
-			delete command;
-		}
-
+		commands.resize(kept);
 		return true;
 	}
 };
 
+// Commands are pooled so posting one doesn't allocate once the pool has warmed up.
 class FuncCommand : Command {
 	bool shouldAbort = false;
+
+	// Done pooled commands returned from the main thread.
+	static AtomicStack<Command>& GetPool() {
+		static AtomicStack<Command> pool;
+		return pool;
+	}
+	// Commands a thread has taken from the pool.
+	// Taking the whole pool at once keeps it lock-free.
+	struct PoolCache {
+		FuncCommand* head = nullptr;
+
+		~PoolCache() {
+			while (auto c = head) {
+				head = static_cast<FuncCommand*>(c->next);
+				GetPool().Push(c);
+			}
+		}
+	};
+	static FuncCommand* TakeFromPool() {
+		thread_local PoolCache cache;
+		if (!cache.head)
+			cache.head = static_cast<FuncCommand*>(GetPool().TakeAll());
+
+		if (auto c = cache.head) {
+			cache.head = static_cast<FuncCommand*>(c->next);
+			return c;
+		}
+
+		return new FuncCommand();
+	}
+
+	FuncCommand() : Command(Unqueued()) {
+		isReady = true;
+	}
+
 protected:
 	virtual bool Execute() {
 		if (!shouldAbort)
@@ -367,9 +707,22 @@ protected:
 
 		return true;
 	};
+	virtual void Retire() {
+		// Release what the function holds before it waits in the pool.
+		func = nullptr;
+		shouldAbort = false;
+		GetPool().Push(this);
+	}
+
 public:
-	FuncCommand() {
-		isReady = true;
+	// Runs the function on the main thread at the end of the frame.
+	// Can be called from any thread.
+	// The command is reused once executed so it can only be aborted before that.
+	static FuncCommand* Post(std::function<void()> func) {
+		auto c = TakeFromPool();
+		c->func = std::move(func);
+		c->Enqueue();
+		return c;
 	}
 
 	void Abort() {
@@ -379,71 +732,236 @@ public:
 	std::function<void()> func;
 };
 
+// Type-erased callable like std::function which keeps the callable in place.
+// Lambdas capturing a few references or pointers and std::function itself
+// are stored without allocating. Bigger callables are kept on the heap.
+template<typename Signature>
+class Delegate;
+
+template<typename R, typename...A>
+class Delegate<R(A...)> {
+	static constexpr size_t Capacity = 8 * sizeof(void*);
+
+	struct Operations {
+		R(*invoke)(void* storage, A... args);
+		// Construct into uninitialized storage.
+		void(*copy)(void* to, const void* from);
+		void(*move)(void* to, void* from);
+		void(*destroy)(void* storage);
+	};
+
+	template<typename F>
+	struct InPlace {
+		static F& Get(void* s) {
+			return *std::launder(reinterpret_cast<F*>(s));
+		}
+		static R Invoke(void* s, A... args) {
+			return Get(s)(std::forward<A>(args)...);
+		}
+		static void Copy(void* to, const void* from) {
+			new (to) F(Get(const_cast<void*>(from)));
+		}
+		static void Move(void* to, void* from) {
+			new (to) F(std::move(Get(from)));
+			Get(from).~F();
+		}
+		static void Destroy(void* s) {
+			Get(s).~F();
+		}
+		static constexpr Operations operations = { Invoke, Copy, Move, Destroy };
+	};
+	template<typename F>
+	struct OnHeap {
+		static F*& Get(void* s) {
+			return *std::launder(reinterpret_cast<F**>(s));
+		}
+		static R Invoke(void* s, A... args) {
+			return (*Get(s))(std::forward<A>(args)...);
+		}
+		static void Copy(void* to, const void* from) {
+			new (to) F*(new F(*Get(const_cast<void*>(from))));
+		}
+		static void Move(void* to, void* from) {
+			new (to) F*(Get(from));
+		}
+		static void Destroy(void* s) {
+			delete Get(s);
+		}
+		static constexpr Operations operations = { Invoke, Copy, Move, Destroy };
+	};
+
+	alignas(std::max_align_t) unsigned char storage[Capacity];
+	const Operations* operations = nullptr;
+
+	void Assign(const Operations* o, const void* from) {
+		operations = o;
+		if (operations)
+			operations->copy(storage, from);
+	}
+	void Take(Delegate& o) {
+		operations = o.operations;
+		if (operations)
+			operations->move(storage, o.storage);
+		o.operations = nullptr;
+	}
+
+public:
+	Delegate() {}
+	template<typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Delegate>>>
+	Delegate(F&& f) {
+		using D = std::decay_t<F>;
+		if constexpr (sizeof(D) <= Capacity && alignof(D) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<D>) {
+			new (storage) D(std::forward<F>(f));
+			operations = &InPlace<D>::operations;
+		}
+		else {
+			new (storage) D*(new D(std::forward<F>(f)));
+			operations = &OnHeap<D>::operations;
+		}
+	}
+	Delegate(const Delegate& o) {
+		Assign(o.operations, o.storage);
+	}
+	Delegate(Delegate&& o) noexcept {
+		Take(o);
+	}
+	Delegate& operator=(const Delegate& o) {
+		if (this != &o) {
+			Reset();
+			Assign(o.operations, o.storage);
+		}
+		return *this;
+	}
+	Delegate& operator=(Delegate&& o) noexcept {
+		if (this != &o) {
+			Reset();
+			Take(o);
+		}
+		return *this;
+	}
+	~Delegate() {
+		Reset();
+	}
+
+	void Reset() {
+		if (operations)
+			operations->destroy(storage);
+		operations = nullptr;
+	}
+	explicit operator bool() const {
+		return operations != nullptr;
+	}
+	R operator()(A... args) const {
+		return operations->invoke(const_cast<unsigned char*>(storage), std::forward<A>(args)...);
+	}
+};
+
 template<typename...T>
 class IEvent {
-	FuncCommand* modifyHandlersCommand = nullptr;
-	std::map<size_t, std::function<void(const T&...)>> handlersToBeAdded;
+	struct Handler {
+		size_t id;
+		Delegate<void(const T&...)> func;
+	};
+
+	// Changes made by handlers while they are invoked
+	// wait until the outermost invoke returns.
+	std::vector<Handler> handlersToBeAdded;
 	std::vector<size_t> handlersToBeRemoved;
+	int invokeDepth = 0;
+
+	void Insert(Handler&& h) {
+		// Handlers are called in the order of ids which is the order they were added in.
+		if (handlers.empty() || handlers.back().id < h.id)
+			handlers.push_back(std::move(h));
+		else
+			handlers.insert(
+				std::upper_bound(handlers.begin(), handlers.end(), h.id, [](size_t id, const Handler& o) { return id < o.id; }),
+				std::move(h));
+	}
+	void Erase(size_t id) {
+		if (auto h = std::find_if(handlers.begin(), handlers.end(), [id](const Handler& o) { return o.id == id; }); h != handlers.end())
+			handlers.erase(h);
+	}
+	// Shared by all events with these arguments so AddHandlersFrom keeps ids unique.
+	static size_t NextId() {
+		static size_t id = 0;
+		return id++;
+	}
+	void Add(Handler&& h) {
+		if (invokeDepth)
+			handlersToBeAdded.push_back(std::move(h));
+		else
+			Insert(std::move(h));
+	}
+	void ApplyChanges() {
+		for (auto& h : handlersToBeAdded)
+			Insert(std::move(h));
+		for (auto id : handlersToBeRemoved)
+			Erase(id);
 
-	void EnsureModifyHandlersCommand() {
-		if (!modifyHandlersCommand) {
-			modifyHandlersCommand = new FuncCommand();
-			modifyHandlersCommand->func = [&] {
-				handlers.insert(handlersToBeAdded.begin(), handlersToBeAdded.end());
-				for (auto h : handlersToBeRemoved)
-					handlers.erase(h);
-
-				modifyHandlersCommand = nullptr;
-				handlersToBeAdded.clear();
-				handlersToBeRemoved.clear();
-			};
-		}
+		handlersToBeAdded.clear();
+		handlersToBeRemoved.clear();
 	}
+
+	struct InvokeScope {
+		IEvent& e;
+		InvokeScope(IEvent& e) : e(e) {
+			e.invokeDepth++;
+		}
+		~InvokeScope() {
+			if (--e.invokeDepth == 0 && (!e.handlersToBeAdded.empty() || !e.handlersToBeRemoved.empty()))
+				e.ApplyChanges();
+		}
+	};
+
 protected:
-	std::map<size_t, std::function<void(const T&...)>> handlers;
+	std::vector<Handler> handlers;
+
+	void InvokeHandlers(const T&... vs) {
+		InvokeScope scope(*this);
+		for (auto& h : handlers)
+			h.func(vs...);
+	}
+
 public:
-	size_t AddHandler(std::function<void(const T&...)> func) {
-		static size_t id = 0;
+	template<typename F>
+	size_t AddHandler(F&& func) {
+		auto id = NextId();
 
-		handlersToBeAdded[id] = func;
-		EnsureModifyHandlersCommand();
+		Add({ id, std::forward<F>(func) });
 
-		return id++;
+		return id;
 	}
 
 	void RemoveHandler(size_t v) {
-		handlersToBeRemoved.push_back(v);
-		EnsureModifyHandlersCommand();
+		if (invokeDepth)
+			handlersToBeRemoved.push_back(v);
+		else
+			Erase(v);
 	}
 
-	size_t operator += (std::function<void(const T&...)> func) {
-		return AddHandler(func);
+	template<typename F>
+	size_t operator += (F&& func) {
+		return AddHandler(std::forward<F>(func));
 	}
 	void operator -= (size_t v) {
 		RemoveHandler(v);
 	}
 
-	~IEvent() {
-		// Commands will be executed with skipping the assigned func 
-		// and then will be deleted so we only need to abort them.
-		if (modifyHandlersCommand)
-			modifyHandlersCommand->Abort();
-	}
-
 	void AddHandlersFrom(const IEvent<T...>& o) {
-		handlersToBeAdded.insert(o.handlers.begin(), o.handlers.end());
-		handlersToBeAdded.insert(o.handlersToBeAdded.begin(), o.handlersToBeAdded.end());
-		handlersToBeRemoved.insert(handlersToBeRemoved.end(), o.handlersToBeRemoved.begin(), o.handlersToBeRemoved.end());
-
-		EnsureModifyHandlersCommand();
+		for (auto& h : o.handlers)
+			Add(Handler(h));
+		for (auto& h : o.handlersToBeAdded)
+			Add(Handler(h));
+		for (auto id : o.handlersToBeRemoved)
+			RemoveHandler(id);
 	}
 };
 template<typename...T>
 class Event : public IEvent<T...> {
 public:
 	void Invoke(const T&... vs) {
-		for (auto h : IEvent<T...>::handlers)
-			h.second(vs...);
+		IEvent<T...>::InvokeHandlers(vs...);
 	}
 	IEvent<T...>& Public() {
 		return *this;
@@ -776,6 +1294,12 @@ static Property<type>& name() {\
 	return v;\
 }
 
+#define StaticPropertyDefault(type,name,defaultValue)\
+static Property<type>& name() {\
+	static Property<type> v = Property<type>(defaultValue);\
+	return v;\
+}
+
 #define StaticField(type,name)\
 static type& name() {\
 	static type v;\
@@ -801,13 +1325,80 @@ public:
 		currentValueMatches = condition(v);
 	}
 
-	void IsStable() {
+	bool IsStable() {
 		return lastValueMatches && currentValueMatches;
 	}
-	void IsBroken() {
+	bool IsBroken() {
 		return lastValueMatches && !currentValueMatches;
 	}
-	void IsRepaired() {
+	bool IsRepaired() {
 		return !lastValueMatches && currentValueMatches;
 	}
-};
\ No newline at end of file
+};
+
+// Hands the newest value from one producer thread to one consumer thread.
+// Three buffers are rotated so neither side waits for the other.
+// A value published before the previous one was taken replaces it.
+template<typename T>
+class LatestSlot {
+	static constexpr int freshBit = 4;
+
+	T buffers[3];
+	// Index of the buffer between the producer and the consumer
+	// and whether it holds a value the consumer hasn't taken.
+	std::atomic<int> middle = 0;
+	int back = 1;
+	int front = 2;
+
+	// Only used to put an idle consumer to sleep.
+	std::mutex mutex;
+	std::condition_variable hasValue;
+	bool isWakeRequested = false;
+
+	bool IsFresh() const {
+		return middle.load(std::memory_order_acquire) & freshBit;
+	}
+public:
+	// Buffer to be filled by the producer before Publish.
+	T& Back() {
+		return buffers[back];
+	}
+	void Publish() {
+		back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & ~freshBit;
+
+		// Taking the lock prevents a wakeup from being lost
+		// between the consumer's check and wait.
+		{ std::lock_guard lock(mutex); }
+		hasValue.notify_one();
+	}
+
+	// Returns the newest value or nullptr if there is nothing new.
+	// The value stays valid until the next take.
+	T* TryTake() {
+		if (!IsFresh())
+			return nullptr;
+
+		front = middle.exchange(front, std::memory_order_acq_rel) & ~freshBit;
+		return &buffers[front];
+	}
+	template<typename Rep, typename Period>
+	T* Take(const std::chrono::duration<Rep, Period>& timeout) {
+		if (auto v = TryTake())
+			return v;
+
+		std::unique_lock lock(mutex);
+		hasValue.wait_for(lock, timeout, [this] { return IsFresh() || isWakeRequested; });
+		isWakeRequested = false;
+		lock.unlock();
+
+		return TryTake();
+	}
+	// Wakes a waiting consumer without a new value.
+	void Wake() {
+		{
+			std::lock_guard lock(mutex);
+			isWakeRequested = true;
+		}
+		hasValue.notify_all();
+	}
+};
@@ -6,6 +6,7 @@
 #include <map>
 #include <vector>
 #include "Key.hpp"
+#include "Profiler.hpp"
 
 
 
@@ -121,12 +122,12 @@ class Input {
 
 		auto modifiersNext = (*modifiersCurrent) + 1;
 
-		if (auto c = node.children.find(*modifiersCurrent->_Ptr);
+		if (auto c = node.children.find(**modifiersCurrent);
 			c != node.children.end())
-			return InsertCombination(c._Ptr->_Myval.second, &modifiersNext, modifiersEnd, endKey, callback);
+			return InsertCombination(c->second, &modifiersNext, modifiersEnd, endKey, callback);
 
-		node.children[*modifiersCurrent->_Ptr] = CombinationNode();
-		return InsertCombination(node.children[*modifiersCurrent->_Ptr], &modifiersNext, modifiersEnd, endKey, callback);
+		node.children[**modifiersCurrent] = CombinationNode();
+		return InsertCombination(node.children[**modifiersCurrent], &modifiersNext, modifiersEnd, endKey, callback);
 	}
 
 
@@ -290,17 +291,16 @@ public:
 		// 0 means it isn't assigned.
 		static size_t id = 1;
 
-		(new FuncCommand())->func = [id = id, func = func] {
+		FuncCommand::Post([id = id, func = func] {
 			handlers()[id] = func;
-		};
+		});
 
 		return id++;
 	}
 	static void RemoveHandler(size_t& id) {
-		auto cmd = new FuncCommand();
-		cmd->func = [id] {
+		FuncCommand::Post([id] {
 			handlers().erase(id);
-		};
+		});
 		id = 0;
 	}
 
@@ -313,6 +313,7 @@ public:
 
 
 	static void ProcessInput() {
+		PROFILE_SCOPE("Input::ProcessInput");
 		FillAxes();
 
 		{
@@ -435,7 +436,7 @@ class KeyBinding {
 			}
 			else if (Input::IsPressed(Key::Modifier::Control)) {
 				if (Input::IsDown(Key::N5, true) && !ObjectSelection::Selected().empty())
-					Scene::cross()->SetWorldRotation(ObjectSelection::Selected().begin()._Ptr->_Myval->GetWorldRotation());
+					Scene::cross()->SetWorldRotation((*ObjectSelection::Selected().begin())->GetWorldRotation());
 				else if (Input::IsDown(Key::N0, true))
 					Scene::cross()->SetWorldRotation(glm::quat(1, 0, 0, 0));
 			}
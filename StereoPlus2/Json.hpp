@@ -1,10 +1,18 @@
 #pragma once
-#include <gl\GL.h>
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
+#include <string_view>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <fstream>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+#include "MemoryUsage.hpp"
 
 // Json
 template<typename T>
@@ -17,6 +25,7 @@ struct J {
 	};
 	struct ObjectAbstract {
 		virtual JType GetType() const = 0;
+		virtual ~ObjectAbstract() {}
 	};
 	struct Object : ObjectAbstract {
 		std::unordered_map<T, ObjectAbstract*> objects;
@@ -60,7 +69,6 @@ struct J {
 };
 
 struct Js : J<std::string> {};
-struct Jw : J<std::wstring> {};
 
 
 class ojstreams {
@@ -69,13 +77,11 @@ class ojstreams {
 public:
 	template<typename T>
 	void put(const T& val) {
-		throw std::exception("Unsupported Type found while writing file.");
+		throw std::runtime_error("Unsupported Type found while writing file.");
 	}
-	template<>
 	void put(const std::string& val) {
 		buffer << '"' << val << '"';
 	}
-	template<>
 	void put(const Js::ObjectAbstract& joa) {
 		switch (joa.GetType()) {
 		case Js::JPrimitive:
@@ -131,435 +137,409 @@ public:
 	}
 };
 
-class ijstreams {
-	std::istringstream buffer;
-
-	void skipName() {
-		while (buffer.get() != ':');
-	}
-	void skip() {
-		char a = buffer.get();
-	}
-	// Skips comma if exists.
-	void skipComma() {
-		if (buffer.get() == ',')
-			return;
+// Bump allocator for Json DOM nodes.
+// Everything allocated from it lives as long as the arena
+// and is released at once when the arena is destroyed.
+class JsonArena {
+	struct Block {
+		Block* next;
+		size_t size;
+		size_t used;
+	};
 
-		buffer.seekg(-1, std::ios_base::cur);
-	}
-	void skipWhiteSpace() {
-		if (isWhiteSpace(buffer.get()))
-			skipWhiteSpace();
-		else
-			buffer.seekg(-1, std::ios_base::cur);
-	}
-	void skipColon() {
-		if (buffer.get() == L':')
-			return;
+	Block* head = nullptr;
+	size_t nextBlockSize;
+	size_t allocatedSize = 0;
 
-		buffer.seekg(-1, std::ios_base::cur);
+	static size_t Align(size_t v, size_t alignment) {
+		return (v + alignment - 1) & ~(alignment - 1);
 	}
-
-	bool isWhiteSpace(const char& c) {
-		switch (c) {
-		case ' ':
-		case '\n':
-		case '\r':
-		case '\t':
-			return true;
-		default:
-			return false;
-		}
+	static char* GetData(Block* b) {
+		return (char*)b + Align(sizeof(Block), alignof(std::max_align_t));
 	}
 
-	bool isString() {
-		bool is = false;
-
-		if (buffer.get() == '"')
-			is = true;
+	void AddBlock(size_t minSize) {
+		auto size = nextBlockSize < minSize ? minSize : nextBlockSize;
+		auto b = (Block*)malloc(Align(sizeof(Block), alignof(std::max_align_t)) + size);
+		if (!b)
+			throw std::bad_alloc();
 
-		buffer.seekg(-1, std::ios_base::cur);
+		b->next = head;
+		b->size = size;
+		b->used = 0;
+		head = b;
 
-		return is;
+		allocatedSize += size;
+		nextBlockSize = size * 2;
 	}
-	bool isObject() {
-		bool is = false;
-
-		if (buffer.get() == '{')
-			is = true;
-
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+public:
+	JsonArena(size_t initialSize = 4096) : nextBlockSize(initialSize) {}
+	JsonArena(const JsonArena&) = delete;
+	JsonArena& operator=(const JsonArena&) = delete;
+	~JsonArena() {
+		while (head) {
+			auto next = head->next;
+			free(head);
+			head = next;
+		}
 	}
-	bool isObjectEnd() {
-		bool is = false;
 
-		if (buffer.get() == '}')
-			is = true;
+	void* Allocate(size_t size, size_t alignment) {
+		if (!head || Align(head->used, alignment) + size > head->size)
+			AddBlock(size + alignment);
 
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+		auto offset = Align(head->used, alignment);
+		head->used = offset + size;
+		return GetData(head) + offset;
 	}
-	bool isArray() {
-		bool is = false;
-
-		if (buffer.get() == '[')
-			is = true;
 
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+	// Only trivially destructible types are allowed
+	// since destructors are never called.
+	template<typename T>
+	T* New() {
+		static_assert(std::is_trivially_destructible_v<T>);
+		return new (Allocate(sizeof(T), alignof(T))) T();
 	}
-	bool isArrayEnd() {
-		bool is = false;
-
-		if (buffer.get() == ']')
-			is = true;
-
-		buffer.seekg(-1, std::ios_base::cur);
+	template<typename T>
+	T* NewArray(size_t count) {
+		static_assert(std::is_trivially_destructible_v<T>);
+		if (count == 0)
+			return nullptr;
 
-		return is;
+		return (T*)Allocate(sizeof(T) * count, alignof(T));
 	}
-	bool isArrayEmpty() {
-		bool is = false;
 
-		skip();//[
-		if (buffer.get() == ']')
-			is = true;
-
-		buffer.seekg(-2, std::ios_base::cur);
-
-		return is;
+	size_t GetAllocatedSize() const {
+		return allocatedSize;
 	}
+};
 
-	std::string readName() {
-		std::string v;
-		char c;
-
-		skipWhiteSpace();
-		skip();//"
-		while ((c = buffer.get()) != '"')
-			v += c;
-
-		skipWhiteSpace();
-		skipColon();//:
-		return v;
-	}
-	Js::ObjectAbstract* readValue() {
-		skipWhiteSpace();
-		std::string v;
-		char c;
-		bool isString = (c = buffer.get()) == '"';
+// Json view.
+// Read-only DOM allocated in JsonArena.
+// Keys and values are views into the source buffer of JsonDocument.
+struct Jv {
+	enum JType {
+		JObject,
+		JArray,
+		JPrimitive,
+		JPrimitiveString,
+	};
+	struct ObjectAbstract {
+		JType type;
 
-		if (!isString)
-			v += c;
+		JType GetType() const {
+			return type;
+		}
+	};
+	struct Member {
+		std::string_view key;
+		const ObjectAbstract* value;
+	};
+	// Members are sorted by key.
+	struct Object : ObjectAbstract {
+		// Objects up to this size are searched linearly.
+		static const size_t linearSearchSize = 8;
 
-		while (c = buffer.get(), isString ? (c != '"') : (c != ',' && c != ']' && c != '}'))
-			v += c;
+		const Member* members = nullptr;
+		size_t size = 0;
 
-		if (c == ']' || c == '}')
-			buffer.seekg(-1, std::ios_base::cur);
+		const Member* begin() const {
+			return members;
+		}
+		const Member* end() const {
+			return members + size;
+		}
 
-		skipWhiteSpace();
-		skipComma();
+		// Returns nullptr if not found.
+		const ObjectAbstract* Find(std::string_view key) const {
+			if (size <= linearSearchSize) {
+				for (auto& m : *this)
+					if (m.key == key)
+						return m.value;
+				return nullptr;
+			}
 
-		if (isString) {
-			auto o = new Js::PrimitiveString();
-			o->value = v;
-			return o;
+			auto m = std::lower_bound(begin(), end(), key, [](const Member& m, std::string_view k) { return m.key < k; });
+			if (m != end() && m->key == key)
+				return m->value;
+			return nullptr;
 		}
+	};
+	struct Array : ObjectAbstract {
+		const ObjectAbstract* const* objects = nullptr;
+		size_t size = 0;
 
-		auto o = new Js::Primitive();
-		o->value = v;
-		return o;
-	}
-
-public:
-	
-	Js::ObjectAbstract* getJson() {
-		skipWhiteSpace();
-		skipColon();
-		skipWhiteSpace();
-		if (isObject()) {
-			auto o = new Js::Object();
-			skipWhiteSpace();
-			skip();//{
-			while (skipWhiteSpace(), !isObjectEnd())//}
-				o->objects.insert({ readName(), getJson() });
-			skip();//}
-			skipWhiteSpace();
-			skipComma();
-			return o;
+		const ObjectAbstract* const* begin() const {
+			return objects;
 		}
-		if (isArray()) {
-			auto o = new Js::Array();
-			skipWhiteSpace();
-			skip();//[
-			while (skipWhiteSpace(), !isArrayEnd())//]
-				o->objects.push_back(getJson());
-			skip();//]
-			skipWhiteSpace();
-			skipComma();
-			return o;
+		const ObjectAbstract* const* end() const {
+			return objects + size;
 		}
-		return readValue();
-	}
-
-	void setBuffer(char* buf) {
-		buffer = std::istringstream(buf);
-	}
+		const ObjectAbstract* operator[](size_t i) const {
+			return objects[i];
+		}
+	};
+	struct Primitive : ObjectAbstract {
+		std::string_view value;
+	};
+	struct PrimitiveString : ObjectAbstract {
+		std::string_view value;
+	};
 };
 
-class ijstreamw {
-	std::wistringstream buffer;
-
-	wchar_t getwc() {
-		wchar_t v;
-		buffer.readsome(&v, 1);
-		//((char*)&v)[1] = buffer.get();
-		//((char*)&v)[0] = buffer.get();
-		return v;
-	}
+// Parses Json into Jv nodes without copying any strings.
+class ijstreamv {
+	const char* pos;
+	const char* end;
+	JsonArena* arena;
 
+	// Scratch space reused between objects and arrays
+	// so that only the final node storage goes to the arena.
+	std::vector<Jv::Member> memberStack;
+	std::vector<const Jv::ObjectAbstract*> elementStack;
 
-	void skipName() {
-		while (getwc() != L':');
+	[[noreturn]] void Fail() {
+		throw std::runtime_error("Invalid Json.");
 	}
-	void skip() {
-		auto a = getwc();
-	}
-	// Skips comma if exists.
-	void skipComma() {
-		if (getwc() == L',')
-			return;
 
-		buffer.seekg(-1, std::ios_base::cur);
-	}
-	void skipWhiteSpace() {
-		auto c = getwc();
+	static bool isWhiteSpace(const char& c) {
 		switch (c) {
-		case L' ':
-		case L'\n':
-		case L'\r':
-		case L'\t':
-			return skipWhiteSpace();
+		case ' ':
+		case '\n':
+		case '\r':
+		case '\t':
+			return true;
 		default:
-			buffer.seekg(-1, std::ios_base::cur);
-			break;
+			return false;
 		}
 	}
-	void skipColon() {
-		if (getwc() == L':')
-			return;
 
-		buffer.seekg(-1, std::ios_base::cur);
+	void skipWhiteSpace() {
+		while (pos < end && isWhiteSpace(*pos))
+			pos++;
 	}
-
-	bool isString() {
-		bool is = false;
-
-		if (getwc() == L'"')
-			is = true;
-
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+	char peek() {
+		skipWhiteSpace();
+		if (pos >= end)
+			Fail();
+		return *pos;
 	}
-	bool isObject() {
-		bool is = false;
-
-		if (getwc() == L'{')
-			is = true;
-
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+	// Skips c if exists.
+	void skip(char c) {
+		if (peek() == c)
+			pos++;
 	}
-	bool isObjectEnd() {
-		bool is = false;
-
-		if (getwc() == L'}')
-			is = true;
-
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+	// Skips the comma after a member or an element.
+	// Anything but the comma or the closing bracket would never be read.
+	void skipSeparator(char close) {
+		if (auto c = peek(); c == ',')
+			pos++;
+		else if (c != close)
+			Fail();
 	}
-	bool isArray() {
-		bool is = false;
 
-		if (getwc() == L'[')
-			is = true;
+	std::string_view readString() {
+		pos++;//"
+		auto begin = pos;
+		while (pos < end && *pos != '"')
+			pos += *pos == '\\' ? 2 : 1;
 
-		buffer.seekg(-1, std::ios_base::cur);
+		if (pos >= end)
+			Fail();
 
-		return is;
+		return std::string_view(begin, pos++ - begin);
 	}
-	bool isArrayEnd() {
-		bool is = false;
+	std::string_view readPrimitive() {
+		auto begin = pos;
+		while (pos < end && *pos != ',' && *pos != ']' && *pos != '}' && !isWhiteSpace(*pos))
+			pos++;
 
-		if (getwc() == L']')
-			is = true;
+		// A bracket or a comma where the value should be.
+		if (pos == begin)
+			Fail();
 
-		buffer.seekg(-1, std::ios_base::cur);
-
-		return is;
+		return std::string_view(begin, pos - begin);
 	}
-	bool isArrayEmpty() {
-		bool is = false;
 
-		skip();//[
-		if (getwc() == L']')
-			is = true;
+	const Jv::ObjectAbstract* readObject() {
+		pos++;//{
+		auto first = memberStack.size();
 
-		buffer.seekg(-2, std::ios_base::cur);
+		while (peek() != '}') {
+			if (*pos != '"')
+				Fail();
 
-		return is;
-	}
+			auto key = readString();
+			skip(':');
+			auto value = readValue();
+			memberStack.push_back({ key, value });
+			skipSeparator('}');
+		}
+		pos++;//}
 
-	std::wstring readName() {
-		std::wstring v;
-		wchar_t c;
+		auto o = arena->New<Jv::Object>();
+		o->type = Jv::JObject;
+		o->size = memberStack.size() - first;
 
-		skipWhiteSpace();
-		skip();//"
-		while ((c = getwc()) != L'"')
-			v += c;
+		auto members = arena->NewArray<Jv::Member>(o->size);
+		std::copy(memberStack.begin() + first, memberStack.end(), members);
+		// Stable to keep the first of duplicate keys found by Find.
+		std::stable_sort(members, members + o->size, [](const Jv::Member& a, const Jv::Member& b) { return a.key < b.key; });
+		o->members = members;
 
-		skipWhiteSpace();
-		skipColon();
-		return v;
+		memberStack.resize(first);
+		return o;
 	}
-	Jw::ObjectAbstract* readValue() {
-		skipWhiteSpace();
-		std::wstring v;
-		wchar_t c;
-		bool isString = (c = getwc()) == L'"';
-
-		if (!isString)
-			v += c;
-
-		while (c = getwc(), isString ? (c != L'"') : (c != L',' && c != L']' && c!= L'}'))
-			v += c;
+	const Jv::ObjectAbstract* readArray() {
+		pos++;//[
+		auto first = elementStack.size();
 
-		if (c == L']' || c == L'}')
-			buffer.seekg(-1, std::ios_base::cur);
+		while (peek() != ']') {
+			elementStack.push_back(readValue());
+			skipSeparator(']');
+		}
+		pos++;//]
 
-		skipWhiteSpace();
-		skipComma();
+		auto o = arena->New<Jv::Array>();
+		o->type = Jv::JArray;
+		o->size = elementStack.size() - first;
 
-		if (isString) {
-			auto o = new Jw::PrimitiveString();
-			o->value = v;
-			return o;
-		}
+		auto objects = arena->NewArray<const Jv::ObjectAbstract*>(o->size);
+		std::copy(elementStack.begin() + first, elementStack.end(), objects);
+		o->objects = objects;
 
-		auto o = new Jw::Primitive();
-		o->value = v;
+		elementStack.resize(first);
 		return o;
 	}
-
-public:
-	Jw::ObjectAbstract* getJson() {
-		skipWhiteSpace();
-		skipColon();
-		skipWhiteSpace();
-		if (isObject()) {
-			auto o = new Jw::Object();
-			skipWhiteSpace();
-			skip();//{
-			while (skipWhiteSpace(), !isObjectEnd())//}
-				o->objects.insert({ readName(), getJson() });
-			skip();//}
-			skipWhiteSpace();
-			skipComma();
+	const Jv::ObjectAbstract* readValue() {
+		switch (peek()) {
+		case '{':
+			return readObject();
+		case '[':
+			return readArray();
+		case '"':
+		{
+			auto o = arena->New<Jv::PrimitiveString>();
+			o->type = Jv::JPrimitiveString;
+			o->value = readString();
 			return o;
 		}
-		if (isArray()) {
-			auto o = new Jw::Array();
-			skipWhiteSpace();
-			skip();//[
-			while (skipWhiteSpace(), !isArrayEnd())//]
-				o->objects.push_back(getJson());
-			skip();//]
-			skipWhiteSpace();
-			skipComma();
+		default:
+		{
+			auto o = arena->New<Jv::Primitive>();
+			o->type = Jv::JPrimitive;
+			o->value = readPrimitive();
 			return o;
 		}
-		return readValue();
+		}
 	}
 
-	void setBuffer(wchar_t* buf) {
-		buffer = std::wistringstream(buf);
+public:
+	const Jv::ObjectAbstract* getJson(std::string_view source, JsonArena* arena) {
+		pos = source.data();
+		end = source.data() + source.size();
+		this->arena = arena;
+
+		return readValue();
 	}
 };
 
-class Json {
-	static size_t GetFileSize(std::string filename) {
-		std::ifstream in(filename, std::ios::binary | std::ios::in | std::ios::ate);
-
-		if (in)
-			return in.tellg();
-
-		return 0;
+// Owns the source text and the arena of a parsed Json.
+// Node strings point into the source
+// so the document can be neither copied nor moved.
+class JsonDocument {
+	std::string source;
+	JsonArena arena;
+	const Jv::ObjectAbstract* root = nullptr;
+	MemoryUsage::Tracked trackedSize = MemoryUsage::Tracked(MemoryUsage::Category::JsonDocuments);
+public:
+	JsonDocument(std::string&& text)
+		// Nodes take roughly as much space as the text they are parsed from.
+		: source(std::move(text)), arena(source.size() + 1024) {
+		ijstreamv str;
+		root = str.getJson(source, &arena);
+		trackedSize.Set(GetSize());
 	}
-	static size_t GetFileSizeW(std::string filename) {
-		std::wifstream in(filename, std::ios::binary | std::ios::in | std::ios::ate);
+	JsonDocument(const JsonDocument&) = delete;
+	JsonDocument& operator=(const JsonDocument&) = delete;
 
-		if (in)
-			return in.tellg();
+	const Jv::ObjectAbstract* Root() const {
+		return root;
+	}
 
-		return 0;
+	// Bytes held by the document.
+	size_t GetSize() const {
+		return source.capacity() + arena.GetAllocatedSize();
 	}
+};
 
-	static wchar_t* Read(std::wifstream& file, size_t size) {
-		file.seekg(2, std::ios_base::beg);
-		size -= 2;
+class Json {
+	static std::string ReadFile(const std::string& filename) {
+		std::ifstream file(filename, std::ios::binary | std::ios::in | std::ios::ate);
+		if (!file)
+			throw std::runtime_error("File could not be opened.");
 
-		auto buffer = new wchar_t[size];
-		for (size_t i = 0; i < size; i++) {
-			((char*)buffer)[i * 2] = file.get();
-			((char*)buffer)[i * 2 + 1] = file.get();
-		}
+		std::string buffer(file.tellg(), '\0');
+		file.seekg(0, std::ios_base::beg);
+		file.read(buffer.data(), buffer.size());
 
 		return buffer;
 	}
 
-public:
-	static Js::ObjectAbstract* Read(const std::string& filename) {
-		std::ifstream file(filename, std::ios::binary | std::ios::in);
-
-		auto bufferSize = GetFileSize(filename);
-		auto buffer = new char[bufferSize];
-		file.read(buffer, bufferSize);
-
-		ijstreams str;
-		str.setBuffer(buffer);
-
-		auto json = str.getJson();
-
-		delete[] buffer;
-		file.close();
-
-		return json;
+	static void AppendUtf8(std::string& dest, char32_t c) {
+		if (c < 0x80)
+			dest += (char)c;
+		else if (c < 0x800) {
+			dest += (char)(0xC0 | (c >> 6));
+			dest += (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000) {
+			dest += (char)(0xE0 | (c >> 12));
+			dest += (char)(0x80 | ((c >> 6) & 0x3F));
+			dest += (char)(0x80 | (c & 0x3F));
+		}
+		else {
+			dest += (char)(0xF0 | (c >> 18));
+			dest += (char)(0x80 | ((c >> 12) & 0x3F));
+			dest += (char)(0x80 | ((c >> 6) & 0x3F));
+			dest += (char)(0x80 | (c & 0x3F));
+		}
 	}
-	static Jw::ObjectAbstract* ReadW(const std::string& filename) {
-		std::wifstream file(filename, std::ios::binary | std::ios::in);
-
-		auto bufferSize = GetFileSizeW(filename);
-		auto buffer = Read(file, bufferSize);
 
-		ijstreamw str;
-		str.setBuffer(buffer);
-
-		auto json = str.getJson();
+	// UTF-16 LE with BOM to UTF-8.
+	static std::string Utf16ToUtf8(const std::string& source) {
+		std::string v;
+		v.reserve(source.size());
+
+		auto unit = [&source](size_t i) {
+			return (char16_t)((unsigned char)source[i] | ((unsigned char)source[i + 1] << 8));
+		};
+
+		// Skip BOM.
+		size_t i = source.size() >= 2 && unit(0) == 0xFEFF ? 2 : 0;
+		for (; i + 1 < source.size(); i += 2) {
+			char32_t c = unit(i);
+			if (c >= 0xD800 && c < 0xDC00 && i + 3 < source.size()) {
+				char32_t low = unit(i + 2);
+				if (low >= 0xDC00 && low < 0xE000) {
+					c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+					i += 2;
+				}
+			}
+			AppendUtf8(v, c);
+		}
 
-		delete[] buffer;
-		file.close();
+		return v;
+	}
 
-		return json;
+public:
+	static std::unique_ptr<JsonDocument> Read(const std::string& filename) {
+		return std::make_unique<JsonDocument>(ReadFile(filename));
+	}
+	// Reads UTF-16 LE file.
+	// Strings in the document are UTF-8.
+	static std::unique_ptr<JsonDocument> ReadW(const std::string& filename) {
+		return std::make_unique<JsonDocument>(Utf16ToUtf8(ReadFile(filename)));
 	}
 
 	static void Write(const std::string& filename, Js::ObjectAbstract* joa) {
@@ -570,4 +550,4 @@ public:
 		out << bs.getBuffer();
 		out.close();
 	}
-};
+};
\ No newline at end of file
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <vector>
+#include <array>
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <fstream>
+#include <thread>
+#include <functional>
+#include <exception>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+// Line sets read from text files produced by other programs.
+struct ImportedLines {
+	struct Object {
+		std::string name;
+		std::vector<glm::vec3> vertices;
+		// Pairs of connected vertices.
+		// Empty for polylines where consecutive vertices are connected.
+		std::vector<std::array<uint32_t, 2>> connections;
+		bool isPolyline = false;
+	};
+	std::vector<Object> objects;
+};
+
+// Reads a text stream in blocks cut at line ends.
+// Each block is split at line ends between threads and parsed in parallel,
+// then the parsed parts are merged in file order on the calling thread.
+// Only one block is kept in memory at a time.
+template<typename TChunk>
+class ParallelLineParser {
+	std::function<void(std::string_view, TChunk&)> parse;
+	std::function<void(TChunk&)> merge;
+
+	static const char* FindLineEnd(const char* begin, const char* end) {
+		auto p = (const char*)memchr(begin, '\n', end - begin);
+		return p ? p + 1 : end;
+	}
+
+	void ParseBlock(const char* begin, const char* end, size_t threadCount) {
+		// Split at line ends.
+		std::vector<const char*> bounds = { begin };
+		for (size_t i = 1; i < threadCount; i++) {
+			auto bound = begin + (end - begin) * i / threadCount;
+			if (bound < bounds.back())
+				bound = bounds.back();
+			bounds.push_back(bound == begin ? begin : FindLineEnd(bound - 1, end));
+		}
+		bounds.push_back(end);
+
+		std::vector<TChunk> chunks(threadCount);
+		std::vector<std::exception_ptr> errors(threadCount);
+		auto run = [&](size_t i) {
+			try {
+				parse(std::string_view(bounds[i], bounds[i + 1] - bounds[i]), chunks[i]);
+			}
+			catch (...) {
+				errors[i] = std::current_exception();
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < threadCount; i++)
+			threads.push_back(std::thread(run, i));
+		run(0);
+		for (auto& t : threads)
+			t.join();
+
+		for (auto& e : errors)
+			if (e)
+				std::rethrow_exception(e);
+
+		for (auto& c : chunks)
+			merge(c);
+	}
+
+public:
+	static constexpr size_t defaultBlockSize = 8 << 20;
+
+	// Bytes parsed by one thread at once.
+	size_t blockSize = defaultBlockSize;
+	size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	ParallelLineParser(std::function<void(std::string_view, TChunk&)> parse, std::function<void(TChunk&)> merge)
+		: parse(parse), merge(merge) {}
+
+	void Parse(std::istream& in) {
+		std::vector<char> block(blockSize * threadCount);
+		size_t carry = 0;
+
+		while (in) {
+			in.read(block.data() + carry, block.size() - carry);
+			auto end = block.data() + carry + in.gcount();
+
+			// Keep the unfinished line for the next block.
+			auto lineEnd = end;
+			if (in)
+				while (lineEnd > block.data() && lineEnd[-1] != '\n')
+					lineEnd--;
+
+			if (lineEnd == block.data() && in) {
+				// A line longer than the block.
+				// Resizing moves the data so the end is kept as an offset.
+				auto filled = (size_t)(end - block.data());
+				block.resize(block.size() * 2);
+				carry = filled;
+				continue;
+			}
+
+			ParseBlock(block.data(), lineEnd, threadCount);
+
+			carry = end - lineEnd;
+			memmove(block.data(), lineEnd, carry);
+		}
+	}
+};
+
+// Common parsing of text records.
+struct TextRecord {
+	static void SkipSpaces(const char*& p, const char* end) {
+		while (p < end && (*p == ' ' || *p == '\t'))
+			p++;
+	}
+	static bool Get(const char*& p, const char* end, float& v) {
+		SkipSpaces(p, end);
+		// from_chars doesn't accept a leading plus.
+		if (p < end && *p == '+')
+			p++;
+
+		auto r = std::from_chars(p, end, v);
+		if (r.ec != std::errc())
+			return false;
+
+		p = r.ptr;
+		return true;
+	}
+	static bool Get(const char*& p, const char* end, int64_t& v) {
+		SkipSpaces(p, end);
+		if (p < end && *p == '+')
+			p++;
+
+		auto r = std::from_chars(p, end, v);
+		if (r.ec != std::errc())
+			return false;
+
+		p = r.ptr;
+		return true;
+	}
+	static std::string_view GetLine(const char*& p, const char* end) {
+		auto begin = p;
+		auto lineEnd = (const char*)memchr(p, '\n', end - p);
+		p = lineEnd ? lineEnd + 1 : end;
+
+		auto last = lineEnd ? lineEnd : end;
+		if (last > begin && last[-1] == '\r')
+			last--;
+
+		return std::string_view(begin, last - begin);
+	}
+	static std::string Trim(std::string_view s) {
+		while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+			s.remove_prefix(1);
+		while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+			s.remove_suffix(1);
+		return std::string(s);
+	}
+};
+
+// Wavefront OBJ reader of "v" and "l" records.
+// Every "o" or "g" record starts a new object which becomes a Mesh
+// with vertices referenced by its lines.
+// Other records are ignored.
+class ObjImporter {
+	// Relative indices can't be resolved until the number of vertices
+	// in previous chunks is known. Until then they are kept shifted by relativeBias.
+	static constexpr int64_t relativeBias = (int64_t)1 << 62;
+
+	struct Chunk {
+		std::vector<glm::vec3> vertices;
+		// 0-based indices into all vertices of the file
+		// or shifted indices into vertices of the chunk.
+		std::vector<std::array<int64_t, 2>> segments;
+		// Objects started in the chunk and their first segments.
+		std::vector<std::pair<std::string, size_t>> objects;
+	};
+
+	struct Object {
+		std::string name;
+		// Indices into all vertices of the file.
+		std::vector<std::array<uint32_t, 2>> segments;
+	};
+
+	static void ParseLineElement(const char* p, const char* end, Chunk& chunk) {
+		bool hasPrevious = false;
+		int64_t previous = 0;
+
+		while (true) {
+			int64_t index;
+			if (!TextRecord::Get(p, end, index))
+				break;
+			// Skip texture coordinate index.
+			while (p < end && *p != ' ' && *p != '\t')
+				p++;
+
+			if (index > 0)
+				index = index - 1;
+			else if (index < 0)
+				index = relativeBias + (int64_t)chunk.vertices.size() + index;
+			else
+				throw std::runtime_error("Invalid OBJ vertex index 0");
+
+			if (hasPrevious)
+				chunk.segments.push_back({ previous, index });
+
+			previous = index;
+			hasPrevious = true;
+		}
+	}
+
+	static void ParseChunk(std::string_view text, Chunk& chunk) {
+		auto p = text.data();
+		auto end = text.data() + text.size();
+
+		while (p < end) {
+			auto line = TextRecord::GetLine(p, end);
+			auto l = line.data();
+			auto lineEnd = line.data() + line.size();
+			TextRecord::SkipSpaces(l, lineEnd);
+
+			if (lineEnd - l < 2 || (l[1] != ' ' && l[1] != '\t'))
+				continue;
+
+			switch (l[0]) {
+			case 'v':
+			{
+				l++;
+				glm::vec3 v;
+				if (!TextRecord::Get(l, lineEnd, v.x)
+					|| !TextRecord::Get(l, lineEnd, v.y)
+					|| !TextRecord::Get(l, lineEnd, v.z))
+					throw std::runtime_error("Invalid OBJ vertex");
+
+				chunk.vertices.push_back(v);
+				break;
+			}
+			case 'l':
+				ParseLineElement(l + 1, lineEnd, chunk);
+				break;
+			case 'o':
+			case 'g':
+				chunk.objects.push_back({ TextRecord::Trim(line.substr(l + 2 - line.data())), chunk.segments.size() });
+				break;
+			}
+		}
+	}
+
+public:
+	static ImportedLines Import(std::istream& in, const std::string& defaultName, size_t blockSize = ParallelLineParser<Chunk>::defaultBlockSize) {
+		std::vector<glm::vec3> vertices;
+		std::vector<Object> objects = { { defaultName, {} } };
+
+		auto resolve = [&vertices](int64_t index, size_t chunkStart) {
+			if (index >= relativeBias / 2)
+				index = index - relativeBias + (int64_t)chunkStart;
+
+			// Connections keep 32 bit indices.
+			if (index < 0 || index >= (int64_t)UINT32_MAX)
+				throw std::runtime_error("OBJ vertex index out of range");
+
+			return (uint32_t)index;
+		};
+
+		ParallelLineParser<Chunk> parser(ParseChunk, [&](Chunk& chunk) {
+			auto chunkStart = vertices.size();
+			vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+
+			auto object = chunk.objects.begin();
+			for (size_t i = 0; i < chunk.segments.size(); i++) {
+				for (; object != chunk.objects.end() && object->second == i; object++)
+					objects.push_back({ object->first, {} });
+
+				objects.back().segments.push_back({
+					resolve(chunk.segments[i][0], chunkStart),
+					resolve(chunk.segments[i][1], chunkStart) });
+			}
+			for (; object != chunk.objects.end(); object++)
+				objects.push_back({ object->first, {} });
+			});
+		parser.blockSize = blockSize;
+		parser.Parse(in);
+
+		// Give every object its own vertices.
+		ImportedLines result;
+		std::vector<uint32_t> localIndices(vertices.size(), UINT32_MAX);
+		for (auto& o : objects) {
+			if (o.segments.empty())
+				continue;
+
+			ImportedLines::Object r;
+			r.name = o.name;
+			r.connections.reserve(o.segments.size());
+
+			for (auto& s : o.segments) {
+				std::array<uint32_t, 2> connection;
+				for (int i = 0; i < 2; i++) {
+					if (s[i] >= vertices.size())
+						throw std::runtime_error("OBJ vertex index out of range");
+
+					auto& local = localIndices[s[i]];
+					if (local == UINT32_MAX) {
+						local = (uint32_t)r.vertices.size();
+						r.vertices.push_back(vertices[s[i]]);
+					}
+					connection[i] = local;
+				}
+				r.connections.push_back(connection);
+			}
+
+			for (auto& s : o.segments)
+				localIndices[s[0]] = localIndices[s[1]] = UINT32_MAX;
+
+			o.segments = {};
+			result.objects.push_back(std::move(r));
+		}
+
+		return result;
+	}
+};
+
+// CSV of polylines with "id,x,y,z" rows.
+// Consecutive rows with the same id form a polyline.
+// Rows that don't contain coordinates such as a header are skipped.
+class CsvPolylineImporter {
+	struct Chunk {
+		std::vector<glm::vec3> vertices;
+		// Polylines started in the chunk and their first vertices.
+		std::vector<std::pair<std::string, size_t>> polylines;
+	};
+
+	static bool SkipSeparator(const char*& p, const char* end) {
+		TextRecord::SkipSpaces(p, end);
+		if (p == end || *p != ',')
+			return false;
+		p++;
+		return true;
+	}
+
+	static void ParseChunk(std::string_view text, Chunk& chunk) {
+		auto p = text.data();
+		auto end = text.data() + text.size();
+
+		while (p < end) {
+			auto line = TextRecord::GetLine(p, end);
+			auto l = line.data();
+			auto lineEnd = line.data() + line.size();
+
+			auto idEnd = (const char*)memchr(l, ',', lineEnd - l);
+			if (!idEnd)
+				continue;
+
+			glm::vec3 v;
+			auto c = idEnd;
+			if (!SkipSeparator(c, lineEnd) || !TextRecord::Get(c, lineEnd, v.x)
+				|| !SkipSeparator(c, lineEnd) || !TextRecord::Get(c, lineEnd, v.y)
+				|| !SkipSeparator(c, lineEnd) || !TextRecord::Get(c, lineEnd, v.z))
+				continue;
+
+			auto id = std::string_view(l, idEnd - l);
+			if (chunk.polylines.empty() || chunk.polylines.back().first != id)
+				chunk.polylines.push_back({ std::string(id), chunk.vertices.size() });
+
+			chunk.vertices.push_back(v);
+		}
+	}
+
+public:
+	static ImportedLines Import(std::istream& in, size_t blockSize = ParallelLineParser<Chunk>::defaultBlockSize) {
+		ImportedLines result;
+
+		ParallelLineParser<Chunk> parser(ParseChunk, [&result](Chunk& chunk) {
+			for (size_t i = 0; i < chunk.polylines.size(); i++) {
+				auto& [id, start] = chunk.polylines[i];
+				auto end = i + 1 < chunk.polylines.size()
+					? chunk.polylines[i + 1].second
+					: chunk.vertices.size();
+
+				// A polyline may continue from the previous chunk.
+				if (result.objects.empty() || result.objects.back().name != id) {
+					result.objects.push_back({ id, {}, {}, true });
+				}
+
+				auto& vertices = result.objects.back().vertices;
+				vertices.insert(vertices.end(), chunk.vertices.begin() + start, chunk.vertices.begin() + end);
+			}
+			});
+		parser.blockSize = blockSize;
+		parser.Parse(in);
+
+		return result;
+	}
+};
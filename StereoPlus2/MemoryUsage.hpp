@@ -0,0 +1,176 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iomanip>
+
+// Bytes held by each subsystem and the most they have held since the start.
+// Counters are updated from any thread.
+class MemoryUsage {
+public:
+	enum class Category {
+		// Scene objects themselves, without the geometry.
+		SceneObjects,
+		SceneVertices,
+		// Vertices with the transformations of the parents applied.
+		SceneCaches,
+		// Vertices projected for the left and the right eye.
+		EyeBuffers,
+		// Vertex and index buffers uploaded to the GPU.
+		GpuBuffers,
+		UndoStates,
+		JsonDocuments,
+		DetectorFrames,
+		Count,
+	};
+
+	static constexpr size_t categoryCount = (size_t)Category::Count;
+
+private:
+	struct Counter {
+		std::atomic<int64_t> current = 0;
+		std::atomic<int64_t> peak = 0;
+	};
+
+	static Counter* counters() {
+		static Counter v[categoryCount];
+		return v;
+	}
+	// Sum of all categories.
+	static Counter& total() {
+		static Counter v;
+		return v;
+	}
+
+	static void Raise(Counter& counter, int64_t delta) {
+		auto value = counter.current.fetch_add(delta, std::memory_order_relaxed) + delta;
+		auto peak = counter.peak.load(std::memory_order_relaxed);
+		while (value > peak && !counter.peak.compare_exchange_weak(peak, value, std::memory_order_relaxed));
+	}
+
+public:
+	// Bytes owned by one object.
+	// Copies start empty because they allocate their own memory.
+	class Tracked {
+		Category category;
+		int64_t bytes = 0;
+	public:
+		Tracked(Category category) : category(category) {}
+		Tracked(const Tracked& o) : category(o.category) {}
+		Tracked& operator=(const Tracked&) {
+			return *this;
+		}
+		~Tracked() {
+			Set(0);
+		}
+
+		void Set(size_t v) {
+			MemoryUsage::Add(category, (int64_t)v - bytes);
+			bytes = v;
+		}
+		size_t Get() const {
+			return bytes;
+		}
+	};
+
+	// Geometry found by counting the scene objects.
+	struct SceneBytes {
+		size_t objects = 0;
+		size_t vertices = 0;
+		size_t caches = 0;
+		size_t eyeBuffers = 0;
+		size_t gpuBuffers = 0;
+
+		// Bytes held on the CPU.
+		size_t GetHostTotal() const {
+			return objects + vertices + caches + eyeBuffers;
+		}
+	};
+
+	template<typename T>
+	static size_t Of(const std::vector<T>& v) {
+		return v.capacity() * sizeof(T);
+	}
+	static size_t Of(const std::string& v) {
+		return v.capacity();
+	}
+
+	static void Add(Category category, int64_t delta) {
+		if (delta == 0)
+			return;
+
+		Raise(counters()[(size_t)category], delta);
+		Raise(total(), delta);
+	}
+	// For categories that are counted all at once instead of tracked on every change.
+	static void Set(Category category, size_t bytes) {
+		auto& counter = counters()[(size_t)category];
+		Add(category, (int64_t)bytes - counter.current.load(std::memory_order_relaxed));
+	}
+	// Replaces the scene categories with a new count.
+	// Their high-water marks are only as fine as the counts.
+	static void Set(const SceneBytes& v) {
+		Set(Category::SceneObjects, v.objects);
+		Set(Category::SceneVertices, v.vertices);
+		Set(Category::SceneCaches, v.caches);
+		Set(Category::EyeBuffers, v.eyeBuffers);
+		Set(Category::GpuBuffers, v.gpuBuffers);
+	}
+
+	static int64_t GetCurrent(Category category) {
+		return counters()[(size_t)category].current.load(std::memory_order_relaxed);
+	}
+	static int64_t GetPeak(Category category) {
+		return counters()[(size_t)category].peak.load(std::memory_order_relaxed);
+	}
+	static int64_t GetTotal() {
+		return total().current.load(std::memory_order_relaxed);
+	}
+	static int64_t GetTotalPeak() {
+		return total().peak.load(std::memory_order_relaxed);
+	}
+
+	// Also the localization key with the "memory:" prefix.
+	static const char* GetName(Category category) {
+		static const char* names[categoryCount] = {
+			"sceneObjects",
+			"sceneVertices",
+			"sceneCaches",
+			"eyeBuffers",
+			"gpuBuffers",
+			"undoStates",
+			"jsonDocuments",
+			"detectorFrames",
+		};
+		return names[(size_t)category];
+	}
+
+	static std::string Format(int64_t bytes) {
+		char text[32];
+		if (bytes < 0 || bytes >= 1 << 20)
+			snprintf(text, sizeof(text), "%.1f MB", bytes / double(1 << 20));
+		else if (bytes >= 1 << 10)
+			snprintf(text, sizeof(text), "%.1f KB", bytes / double(1 << 10));
+		else
+			snprintf(text, sizeof(text), "%lld B", (long long)bytes);
+		return text;
+	}
+
+	static void WriteReport(std::ostream& out) {
+		auto row = [&out](const char* name, int64_t current, int64_t peak) {
+			out << std::left << std::setw(16) << name
+				<< std::right << std::setw(12) << Format(current)
+				<< std::setw(12) << Format(peak) << '\n';
+		};
+
+		out << std::left << std::setw(16) << "category"
+			<< std::right << std::setw(12) << "current"
+			<< std::setw(12) << "peak" << '\n';
+		for (size_t i = 0; i < categoryCount; i++)
+			row(GetName((Category)i), GetCurrent((Category)i), GetPeak((Category)i));
+		row("total", GetTotal(), GetTotalPeak());
+	}
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "opencv2/core/types.hpp"
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <cmath>
+
+// Where the camera is and what it sees.
+struct CameraSetup {
+	glm::vec2 resolution;
+	glm::vec2 viewAngles;
+	// Camera rotation in degrees.
+	glm::vec2 angle;
+	float faceSizeYMillimeters;
+	glm::vec3 screenCenterToCameraDistanceMillimeters;
+};
+
+// Viewer position in millimeters relative to the screen center
+// from the face found in a camera frame.
+class PoseEstimator {
+	static constexpr float degreeToRadian = 3.1415926f * 2 / 360;
+
+	static glm::vec2 divide(const glm::vec2& v1, const glm::vec2& v2) {
+		return glm::vec2(v1.x / v2.x, v1.y / v2.y);
+	}
+
+public:
+	static float GetDistanceToCamera(float pixelFaceSizeY, const CameraSetup& camera) {
+		auto pixelToAngle = divide(camera.resolution, camera.viewAngles);
+		auto angleFaceSize = pixelFaceSizeY / pixelToAngle.y;
+		auto distance = camera.faceSizeYMillimeters / (tan(angleFaceSize / 2.f * degreeToRadian) * 2.f);
+		return distance;
+	}
+
+	// Horizontal, vertical position and distance to the screen.
+	// The frame the face was found in can be reduced from the camera resolution.
+	static glm::vec3 Estimate(const cv::Rect& face, cv::Size frameSize, const CameraSetup& camera) {
+		// View angles are given for the camera resolution.
+		auto frameToCamera = divide(camera.resolution, glm::vec2(frameSize.width, frameSize.height));
+		auto center = glm::vec2(face.x + face.width / 2.f, face.y + face.height / 2.f) * frameToCamera;
+
+		auto pixelToAngle = divide(camera.resolution, camera.viewAngles);
+		auto distanceToCamera = GetDistanceToCamera(face.width * frameToCamera.x, camera);
+
+		auto angleFaceCenterX = (camera.resolution.x / 2.f - center.x) / pixelToAngle.x;
+		auto angleFaceCenterY = (camera.resolution.y / 2.f - center.y) / pixelToAngle.y;
+		auto alpha = camera.angle.y - angleFaceCenterY;
+
+		auto distanceToScreen = distanceToCamera * sin(alpha * degreeToRadian) + camera.screenCenterToCameraDistanceMillimeters.z;
+		auto posHorizontal = distanceToCamera * tan(angleFaceCenterX * degreeToRadian);
+		auto posVerticalRelativeToCamera = distanceToCamera * cos(alpha * degreeToRadian);
+		auto posVertical = posVerticalRelativeToCamera - camera.screenCenterToCameraDistanceMillimeters.y;
+
+		return glm::vec3(posHorizontal, posVertical, distanceToScreen * 1.2);
+	}
+};
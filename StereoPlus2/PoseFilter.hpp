@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <cmath>
+
+// Low-pass filter with a cutoff frequency that grows with speed.
+// Slow movement is smoothed strongly to hide jitter
+// and fast movement is followed closely to keep lag low.
+// Casiez, Roussel, Vogel "1€ Filter" (CHI 2012).
+class OneEuroFilter {
+	bool hasValue = false;
+	float value = 0;
+	// Smoothed rate of change per second.
+	float derivative = 0;
+
+	static float Alpha(float cutoff, float dt) {
+		auto tau = 1 / (2 * 3.1415926f * cutoff);
+		return 1 / (1 + tau / dt);
+	}
+public:
+	// Cutoff frequency in Hz when still.
+	float minCutoff = 1;
+	// Growth of the cutoff frequency with speed.
+	float beta = 0;
+	// Cutoff frequency in Hz of the rate of change.
+	float derivativeCutoff = 1;
+
+	float Apply(float x, float dt) {
+		if (!hasValue) {
+			value = x;
+			derivative = 0;
+			hasValue = true;
+			return value;
+		}
+		if (dt <= 0)
+			return value;
+
+		derivative += Alpha(derivativeCutoff, dt) * ((x - value) / dt - derivative);
+
+		auto cutoff = minCutoff + beta * std::abs(derivative);
+		value += Alpha(cutoff, dt) * (x - value);
+
+		return value;
+	}
+
+	float Value() const {
+		return value;
+	}
+	float Derivative() const {
+		return derivative;
+	}
+
+	void Reset() {
+		hasValue = false;
+	}
+};
+
+// Smooths measured viewer positions and extrapolates them in time
+// assuming constant velocity.
+class PoseFilter {
+	OneEuroFilter axes[3];
+	double lastTime = 0;
+	bool hasTime = false;
+
+public:
+	float minCutoff = 1;
+	float beta = 0;
+	float derivativeCutoff = 1;
+
+	// Time in seconds.
+	void Apply(const glm::vec3& pose, double time) {
+		auto dt = hasTime ? (float)(time - lastTime) : 0.f;
+		if (hasTime && dt <= 0)
+			return;
+
+		for (int i = 0; i < 3; i++) {
+			axes[i].minCutoff = minCutoff;
+			axes[i].beta = beta;
+			axes[i].derivativeCutoff = derivativeCutoff;
+			axes[i].Apply(pose[i], dt);
+		}
+
+		lastTime = time;
+		hasTime = true;
+	}
+
+	glm::vec3 Value() const {
+		return glm::vec3(axes[0].Value(), axes[1].Value(), axes[2].Value());
+	}
+	// Change per second.
+	glm::vec3 Velocity() const {
+		return glm::vec3(axes[0].Derivative(), axes[1].Derivative(), axes[2].Derivative());
+	}
+	// Expected pose at the time.
+	glm::vec3 Predict(double time) const {
+		return Value() + Velocity() * (float)(time - lastTime);
+	}
+	double LastTime() const {
+		return lastTime;
+	}
+
+	void Reset() {
+		for (auto& a : axes)
+			a.Reset();
+		hasTime = false;
+	}
+};
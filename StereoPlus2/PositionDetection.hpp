@@ -8,224 +8,425 @@
 #include "include/glm/glm.hpp"
 #include <queue>
 #include <future>
+#include <memory>
 #include "InfrastructureTypes.hpp"
+#include "Profiler.hpp"
+#include "FrameScheduler.hpp"
+#include "MemoryUsage.hpp"
 #include "GLLoader.hpp"
 #include "Settings.hpp"
+#include "FaceTracking.hpp"
+#include "PoseFilter.hpp"
+#include "PoseEstimation.hpp"
+#include "FrameSource.hpp"
+#include "ExternalPose.hpp"
 
 using namespace std;
 using namespace cv;
 
 class PositionDetector {
-    struct less_than_keyX {
-        inline bool operator() (const glm::vec2& a, const glm::vec2& b) {
-            return a.x < b.x;
-        }
-    };
-    struct less_than_keyY {
-        inline bool operator() (const glm::vec2& a, const glm::vec2& b) {
-            return a.y < b.y;
-        }
+    const Log log = Log::For<PositionDetector>();
+
+    struct Frame {
+        // Reduced to what the detector needs.
+        Mat image;
+        // Number of the frame since the capture start.
+        size_t sequence;
+        std::chrono::steady_clock::time_point captureTime;
     };
 
-    const Log log = Log::For<PositionDetector>();
+    // Detection runs on its own thread so capture never waits for it.
+    // With several workers captured frames are dealt to them in turn.
+    struct DetectionWorker {
+        std::unique_ptr<FaceDetector> faceDetector;
+        FaceTracker faceTracker;
+        LatestSlot<Frame> frames;
+        std::thread thread;
+    };
 
-    VideoCapture capture;
-    CascadeClassifier face_cascade;
+    std::unique_ptr<FrameSource> frameSource;
+    // Captured frames are reduced before they are handed to the workers.
+    DetectionFrameReducer frameReducer;
+    Mat capturedImage;
+    FaceDetectionDurations captureDurations;
+    // Captured image and the reduced frames in the slots of the workers.
+    MemoryUsage::Tracked frameBytes = MemoryUsage::Tracked(MemoryUsage::Category::DetectorFrames);
+    // Takes the place of capture and detection when another process tracks the viewer.
+    std::unique_ptr<ExternalPoseReceiver> externalPoseReceiver;
     CascadeClassifier eyes_cascade;
-    
-    int windowSize = 10;
-    std::list<float> distanceLeftEye, distanceRightEye;
-    std::list<glm::vec2> positionLeftEye, positionRightEye;
+    std::vector<std::unique_ptr<DetectionWorker>> detectionWorkers;
 
+    // Position of detected faces is updated by one worker at a time.
+    std::mutex positionMutex;
+    size_t lastPositionSequence = 0;
+    PoseFilter poseFilter;
+    
     std::atomic<bool> mustStopPositionProcessing;
-    std::thread distanceProcessThread;
+    // Backend of the loaded detectors.
+    std::string loadedBackend;
 
 
-    std::list<float> faceSize;
-    std::list<glm::vec2> facePosition;
-    std::list<float> distanceToCameraBuffer;
+    void detectAndDisplay(const Frame& frame, DetectionWorker& worker)
+    {
+        //-- Detect faces
+        std::vector<Rect> faces;
+        {
+            PROFILE_SCOPE("FaceTracker::Detect");
+            faces = worker.faceTracker.Detect(*worker.faceDetector, frame.image);
+        }
 
+        PROFILE_SCOPE("PositionDetector::UpdatePosition");
+        std::lock_guard lock(positionMutex);
 
-    float avg(std::list<float> q) {
-        float sum = 0;
-        for (auto i : q)
-            sum += i;
+        // Another worker has already applied a newer frame.
+        if (frame.sequence < lastPositionSequence)
+            return;
+        lastPositionSequence = frame.sequence;
 
-        return sum / q.size();
+        updatePosition(faces, frame.image.size(), frame.captureTime);
     }
 
-    template<typename T>
-    const T& at(const std::list<T>& q, int pos) {
-        auto i = q.cbegin();
+    void updatePosition(const std::vector<Rect>& faces, Size frameSize, std::chrono::steady_clock::time_point captureTime)
+    {
+        if (faces.empty())
+            return;
 
-        while (pos-- > 0) i++;
+        // The largest face is likely to be the closest viewer.
+        auto& face = *std::max_element(faces.begin(), faces.end(),
+            [](const Rect& a, const Rect& b) { return a.area() < b.area(); });
 
-        return i._Ptr->_Myval;
-    }
+        auto camera = CameraSetup{
+            Settings::CameraResolution().Get(),
+            Settings::CameraViewAngles().Get(),
+            Settings::CameraAngle().Get(),
+            Settings::FaceSizeYMillimeters().Get(),
+            Settings::ScreenCenterToCameraDistanceMillimeters().Get(),
+        };
+
+        auto time = std::chrono::duration<double>(captureTime.time_since_epoch()).count();
+        poseFilter.minCutoff = Settings::PoseFilterMinCutoff().Get();
+        poseFilter.beta = Settings::PoseFilterBeta().Get();
+        poseFilter.Apply(PoseEstimator::Estimate(face, frameSize, camera), time);
 
-    float medX(std::list<glm::vec2> q) {
-        q.sort(less_than_keyX());
-        return at(q, q.size() / 2).x;
+        // Compensate the time it takes the image to get from the camera to the display.
+        publishPose(poseFilter.Predict(time + Settings::PosePredictionMilliseconds().Get() / 1000), captureTime, lastPositionSequence);
     }
-    float medY(std::list<glm::vec2> q) {
-        q.sort(less_than_keyY());
-        return at(q, q.size() / 2).y;
+
+    void publishPose(const glm::vec3& position, std::chrono::steady_clock::time_point captureTime, size_t sequence)
+    {
+        auto& published = poses.Back();
+        published.position = position;
+        published.captureTime = captureTime;
+        published.sequence = sequence;
+        published.isValid = true;
+        poses.Publish();
+
+        // Only a new pose wakes the idle main loop.
+        FrameScheduler::RequestRedraw();
     }
 
+    // External trackers filter their poses themselves so they are published as they are.
+    void receiveProcess() {
+        auto lastCaptureTime = std::chrono::steady_clock::time_point::min();
+        while (!mustStopPositionProcessing)
+        {
+            // Only the newest of the poses that have arrived is published.
+            ExternalPoseMessage message, received;
+            bool isReceived = false;
+            while (externalPoseReceiver->TryReceive(received))
+            {
+                message = received;
+                isReceived = true;
+            }
 
-    float getPosX(float center, const std::list<glm::vec2>& q, float distance) {
-        auto pixelToAngle = divide(Settings::CameraResolution().Get(), Settings::CameraViewAngles().Get());
-        auto angleFaceSize = (center - medX(q)) / pixelToAngle.x;
-        auto posX = distance * tan(angleFaceSize * degreeToRadian);
-        return posX;
-    }
-    float getPosY(float center, const std::list<glm::vec2>& q, float distance) {
-        auto pixelToAngle = divide(Settings::CameraResolution().Get(), Settings::CameraViewAngles().Get());
-        auto angleFaceSize = (center - medY(q)) / pixelToAngle.x;
-        auto posX = distance * tan(angleFaceSize * degreeToRadian);
-        return posX;
-    }
+            if (!isReceived)
+            {
+                externalPoseReceiver->Wait(std::chrono::milliseconds(100));
+                continue;
+            }
 
-    float getPosY(float center, const std::list<glm::vec2>& q) {
-        float d = center - medY(q);
+            auto captureTime = message.captureTimeMicroseconds
+                ? std::chrono::steady_clock::time_point(std::chrono::microseconds(message.captureTimeMicroseconds))
+                : std::chrono::steady_clock::now();
 
-        return d;
-    }
+            // Datagrams can arrive out of order.
+            if (captureTime < lastCaptureTime)
+                continue;
+            lastCaptureTime = captureTime;
 
-    glm::vec2 divide(const glm::vec2& v1, const glm::vec2& v2) {
-        return glm::vec2(v1.x / v2.x, v1.y / v2.y);
-    }
-    glm::vec2 multiply(const glm::vec2& v1, const glm::vec2& v2) {
-        return glm::vec2(v1.x * v2.x, v1.y * v2.y);
+            PROFILE_SCOPE("PositionDetector::PublishPose");
+            publishPose(glm::vec3(message.position[0], message.position[1], message.position[2]), captureTime, message.sequence);
+        }
     }
 
-    float getDistanceToCamera(const std::list<float>& pixelFaceSizesY) {
-        auto pixelToAngle = divide(Settings::CameraResolution().Get(), Settings::CameraViewAngles().Get());
-        auto angleFaceSize = avg(pixelFaceSizesY) / pixelToAngle.y;
-        auto distance = Settings::FaceSizeYMillimeters().Get() / (tan(angleFaceSize / 2.f * degreeToRadian) * 2.f);
-        return distance;
-    }
+    void distanceProcess() {
+        if (externalPoseReceiver)
+        {
+            receiveProcess();
+            return;
+        }
 
-    void detectAndDisplay(Mat frame)
-    {
-        Mat frame_gray;
-        cvtColor(frame, frame_gray, COLOR_BGR2GRAY);
-        equalizeHist(frame_gray, frame_gray);
+        // Cascades failed to load or there is no video.
+        if (detectionWorkers.empty() || !frameSource)
+            return;
 
-        //-- Detect faces
-        std::vector<Rect> faces;
-        face_cascade.detectMultiScale(frame_gray, faces);
+        lastPositionSequence = 0;
+        poseFilter.Reset();
+        for (auto& w : detectionWorkers)
+            w->thread = std::thread([this, w = w.get()] { detectionProcess(*w); });
 
-        for (size_t i = 0; i < faces.size(); i++)
+        for (size_t sequence = 0; !mustStopPositionProcessing; sequence++)
         {
-            glm::vec2 center(faces[i].x + faces[i].width / 2, faces[i].y + faces[i].height / 2);
+            auto& worker = *detectionWorkers[sequence % detectionWorkers.size()];
+            if (!ProcessFrame(worker.frames.Back(), sequence))
+                break;
+            worker.frames.Publish();
+        }
+
+        // Capture may have failed on its own.
+        mustStopPositionProcessing = true;
+        for (auto& w : detectionWorkers)
+        {
+            w->frames.Wake();
+            w->thread.join();
+        }
+    }
+
+    void detectionProcess(DetectionWorker& worker) {
+        PROFILE_THREAD("faceDetection");
+        while (!mustStopPositionProcessing)
+            if (auto frame = worker.frames.Take(std::chrono::milliseconds(100)))
+                detectAndDisplay(*frame, worker);
+    }
 
-            faceSize.push_back(faces[i].width);
-            facePosition.push_back(center);
+    bool ProcessFrame(Frame& frame, size_t sequence) {
+        {
+            PROFILE_SCOPE("FrameSource::Read");
+            if (!frameSource->Read(capturedImage))
+            {
+                log.Error("No captured frame\n");
+                return false;
+            }
+        }
 
-            if (faceSize.size() > windowSize)
-                faceSize.pop_front();
-            if (facePosition.size() > windowSize)
-                facePosition.pop_front();
+        frame.captureTime = std::chrono::steady_clock::now();
+        frame.sequence = sequence;
 
-            auto distanceToCamera = getDistanceToCamera(faceSize);
-            distanceToCameraBuffer.push_back(distanceToCamera);
-            if (distanceToCameraBuffer.size() > windowSize)
-                distanceToCameraBuffer.pop_front();
-            distanceToCamera = avg(distanceToCameraBuffer);
+        PROFILE_SCOPE("DetectionFrameReducer::Reduce");
+        frameReducer.Reduce(capturedImage, frame.image, captureDurations);
 
-            auto pixelToAngle = divide(Settings::CameraResolution().Get(), Settings::CameraViewAngles().Get());
+        // Every slot holds a frame of the same size once the capture has warmed up.
+        frameBytes.Set(capturedImage.total() * capturedImage.elemSize()
+            + frame.image.total() * frame.image.elemSize() * 3 * detectionWorkers.size());
+        return true;
+    }
 
-            auto facePositionMedianY = medY(facePosition);
-            auto angleFaceCenterY = (frame.size[0] / 2.f - facePositionMedianY) / pixelToAngle.y;
-            auto alpha = Settings::CameraAngle().Get().y - angleFaceCenterY;
-            auto distanceToScreen = distanceToCamera * sin(alpha * degreeToRadian) + Settings::ScreenCenterToCameraDistanceMillimeters().Get().z;
-            distance = distanceToScreen * 1.2;
-            auto posHorizontal = getPosX(frame.size[1] / 2.f, facePosition, distanceToCamera);
-            positionHorizontal = posHorizontal;
 
+public:
+    // Viewer position with the time of the frame it was found in.
+    struct Pose {
+        // Horizontal, vertical position and distance to the screen center in millimeters.
+        glm::vec3 position;
+        std::chrono::steady_clock::time_point captureTime;
+        // Number of the frame since the capture start.
+        size_t sequence = 0;
+        bool isValid = false;
+    };
 
-            auto posVerticalRelativeToCamera = distanceToCamera * cos(alpha * degreeToRadian);
-            auto posVertical = posVerticalRelativeToCamera - Settings::ScreenCenterToCameraDistanceMillimeters().Get().y;
-            positionVertical = posVertical;
-        }
+private:
+    // Published under positionMutex and taken by GetPose.
+    LatestSlot<Pose> poses;
+    Pose lastPose;
 
-        //-- Show what you got
-        //imshow("Capture - Face detection", frame);
-    }
+public:
+    enum class Status {
+        Stopped,
+        // Detectors are loading or the camera is opening.
+        Initializing,
+        Running,
+        // Initialization has failed or the capture has stopped on its own.
+        // Stays until the detection is stopped or restarted.
+        Failed,
+    };
 
-    void distanceProcess() {
-        while (!mustStopPositionProcessing)
+private:
+    std::atomic<Status> status = Status::Stopped;
+
+    // Requests to the control thread.
+    std::mutex controlMutex;
+    std::condition_variable controlChanged;
+    bool isRunRequested = false;
+    bool isRestartRequested = false;
+    bool isStopRequested = false;
+    bool isShutdownRequested = false;
+    std::thread controlThread;
+
+    // Starts and stops the detection on request
+    // so the caller never waits for the camera to open or return its last frame.
+    void controlProcess() {
+        PROFILE_THREAD("positionDetection");
+
+        // Cascades take a while to parse so they are loaded
+        // while the window is being created, before the detection is asked for.
+        if (Settings::PoseProvider().Get() == PoseProvider::Camera)
         {
-            if (!ProcessFrame())
-                break;
+            StartupTimer::Phase phase("Face detectors");
+            if (LoadDetectors())
+                LoadEyesCascade();
         }
-    }
 
-    bool ProcessFrame() {
-        Mat frame;
-        if (capture.read(frame))
+        std::unique_lock lock(controlMutex);
+        while (!isShutdownRequested)
         {
-            if (frame.empty())
+            if (!isRunRequested || (status == Status::Failed && !isRestartRequested))
             {
-                log.Error("No captured frame\n");
-                return false;
+                if (!isRunRequested)
+                    status = Status::Stopped;
+                controlChanged.wait(lock);
+                continue;
             }
 
-            detectAndDisplay(frame);
-            return true;
-        }
+            isRestartRequested = false;
+            isStopRequested = false;
+            mustStopPositionProcessing = false;
+            status = Status::Initializing;
+            lock.unlock();
+
+            auto isInitialized = Init();
+            if (isInitialized && !mustStopPositionProcessing)
+            {
+                status = Status::Running;
+                onStartProcess();
+                distanceProcess();
+                onStopProcess();
+            }
+
+            // Close the camera here rather than on the caller's thread.
+            frameSource.reset();
+            externalPoseReceiver.reset();
 
-        return false;
+            lock.lock();
+            status = isInitialized && isStopRequested ? Status::Stopped : Status::Failed;
+        }
     }
 
+    // A detector can't be shared between threads so every worker loads its own.
+    bool LoadDetectors() {
+        PROFILE_SCOPE("PositionDetector::LoadDetectors");
+        auto backend = Settings::FaceDetectorBackend().Get();
+        auto count = (size_t)Settings::PositionDetectionThreadCount().Get();
 
-public:
-    std::atomic<float>
-        distanceLeft,
-        distanceRight, 
-        distance,
+        // Loaded in advance or by the previous run.
+        if (backend == loadedBackend && detectionWorkers.size() == count)
+            return true;
 
-        positionLeft,
-        positionRight,
-        positionHorizontal,
+        detectionWorkers.clear();
+        loadedBackend.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            auto& worker = *detectionWorkers.emplace_back(std::make_unique<DetectionWorker>());
+            worker.faceDetector = FaceDetector::Create(backend);
+            if (!worker.faceDetector || !worker.faceDetector->Load())
+            {
+                log.Error("Error loading face detector ", backend);
+                detectionWorkers.clear();
+                return false;
+            };
+        }
 
-        heightLeft,
-        heightRight,
-        positionVertical
-        ;
+        loadedBackend = backend;
+        return true;
+    }
 
-    bool isPositionProcessingWorking;
+    bool LoadEyesCascade() {
+        if (!eyes_cascade.empty())
+            return true;
 
+        // Not required so a missing file fails the load instead of throwing.
+        if (!eyes_cascade.load(samples::findFile("haarcascades/haarcascade_eye_tree_eyeglasses.xml", false)))
+        {
+            log.Error("Error loading eyes cascade");
+            return false;
+        }
+        return true;
+    }
+
+public:
     std::function<void()> onStartProcess = [] {};
     std::function<void()> onStopProcess = [] {};
 
+    PositionDetector() {
+        controlThread = std::thread([this] { controlProcess(); });
+    }
+    // Waits for the camera to be released.
+    ~PositionDetector() {
+        {
+            std::lock_guard lock(controlMutex);
+            isShutdownRequested = true;
+            mustStopPositionProcessing = true;
+        }
+        controlChanged.notify_one();
+        controlThread.join();
+    }
 
-    const float degreeToRadian = 3.1415926f * 2 / 360;
+    Status GetStatus() const {
+        return status;
+    }
+    // Localization key of the status.
+    static const std::string& GetStatusName(Status s) {
+        static const std::string names[] = { "stopped", "initializing", "running", "failed" };
+        return names[(int)s];
+    }
 
+    // Newest pose published by the detection.
+    // Position, time and sequence always come from the same frame.
+    // Must be called from one thread only.
+    const Pose& GetPose() {
+        if (auto p = poses.TryTake())
+            lastPose = *p;
+        return lastPose;
+    }
+    // Time since the frame of the newest pose was captured.
+    std::chrono::steady_clock::duration GetPoseAge() {
+        return std::chrono::steady_clock::now() - GetPose().captureTime;
+    }
 
+    // Runs on the control thread.
     bool Init() {
-        String face_cascade_name = samples::findFile("haarcascades/haarcascade_frontalface_alt.xml");
-        String eyes_cascade_name = samples::findFile("haarcascades/haarcascade_eye_tree_eyeglasses.xml");
+        PROFILE_SCOPE("PositionDetector::Init");
+        frameSource.reset();
+        externalPoseReceiver.reset();
+
+        if (auto provider = Settings::PoseProvider().Get(); provider != PoseProvider::Camera)
+            return InitExternalPoseReceiver(provider);
 
         //-- 1. Load the cascades
-        if (!face_cascade.load(face_cascade_name))
-        {
-            log.Error("Error loading face cascade");
+        if (!LoadDetectors())
             return false;
-        };
-        if (!eyes_cascade.load(eyes_cascade_name))
+
+        for (auto& w : detectionWorkers)
         {
-            log.Error("Error loading eyes cascade");
+            // Frames and faces of the previous run are stale.
+            w->frames.TryTake();
+            w->faceTracker.Reset();
+            w->faceTracker.isTrackingEnabled = Settings::IsFaceTrackingEnabled().Get();
+            w->faceTracker.fullDetectionPeriod = Settings::FullFaceDetectionPeriod().Get();
+            w->faceTracker.isMotionGatingEnabled = Settings::IsMotionGatingEnabled().Get();
+            w->faceTracker.motionThreshold = Settings::MotionGateThreshold().Get();
+        }
+        frameReducer.height = Settings::PositionDetectionFrameHeight().Get();
+        frameReducer.isColor = detectionWorkers.front()->faceDetector->IsColorNeeded();
+
+        if (!LoadEyesCascade())
             return false;
-        };
 
-        int camera_device = 0;
         //-- 2. Read the video stream
-        capture.open(camera_device);
-        if (!capture.isOpened())
+        // A recording is replayed at its own rate as if it was a camera.
+        frameSource = FrameSource::Create(Settings::PositionDetectionSource().Get(), true, true);
+        if (!frameSource->Open())
         {
             log.Error("Error opening video capture\n");
+            frameSource.reset();
             return false;
         }
 
@@ -234,32 +435,67 @@ public:
         return true;
     }
 
-    void StartPositionDetection() {
-        if (isPositionProcessingWorking)
-            return;
+    bool InitExternalPoseReceiver(const std::string& provider) {
+        externalPoseReceiver = ExternalPoseReceiver::Create(
+            provider,
+            Settings::ExternalPosePort().Get(),
+            Settings::ExternalPoseSharedMemoryName().Get());
+
+        if (!externalPoseReceiver)
+        {
+            log.Error("Unknown pose provider ", provider);
+            return false;
+        }
+        if (!externalPoseReceiver->Open())
+        {
+            log.Error("Error opening external pose input ", provider);
+            externalPoseReceiver.reset();
+            return false;
+        }
 
-        isPositionProcessingWorking = true;
-        mustStopPositionProcessing = false;
+        return true;
+    }
 
-        // A separate thread for position detection
-        distanceProcessThread = std::thread([=]() {
-            onStartProcess();
-            distanceProcess();
-            onStopProcess();
-        });
+    // Start and stop return at once. The control thread does the work
+    // and GetStatus tells how far it has got.
+    void StartPositionDetection() {
+        {
+            std::lock_guard lock(controlMutex);
+            if (isRunRequested)
+                return;
+            isRunRequested = true;
+            // Try again after a failure.
+            isRestartRequested = true;
+        }
+        controlChanged.notify_one();
+
+        // Forget the pose of the previous run.
+        poses.TryTake();
+        lastPose = Pose();
     }
 
     void StopPositionDetection() {
-        if (!isPositionProcessingWorking)
-            return;
-
-        isPositionProcessingWorking = false;
-        mustStopPositionProcessing = true;
+        {
+            std::lock_guard lock(controlMutex);
+            if (!isRunRequested)
+                return;
+            isRunRequested = false;
+            isStopRequested = true;
+            mustStopPositionProcessing = true;
+        }
+        controlChanged.notify_one();
+    }
 
-        // Join the thread to clean it
-        distanceProcessThread.join();
+    // Runs again with the current settings if the detection is on.
+    void RestartPositionDetection() {
+        {
+            std::lock_guard lock(controlMutex);
+            if (!isRunRequested)
+                return;
+            isRestartRequested = true;
+            isStopRequested = true;
+            mustStopPositionProcessing = true;
+        }
+        controlChanged.notify_one();
     }
 };
-
-
-
@@ -0,0 +1,406 @@
+#pragma once
+
+#include "InfrastructureTypes.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iomanip>
+
+// Timing markers are compiled out entirely when the build defines PROFILER_ENABLED=0.
+// The profiler itself stays so the overlay can tell there is nothing to show.
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#if PROFILER_ENABLED
+#define PROFILER_CONCAT_(a, b) a##b
+#define PROFILER_CONCAT(a, b) PROFILER_CONCAT_(a, b)
+// Times the rest of the enclosing scope. The name must be a string literal.
+#define PROFILE_SCOPE(name) ProfileScope PROFILER_CONCAT(profileScope, __COUNTER__)(name)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_THREAD(name)
+#endif
+
+// Collects timed scopes of every thread into per thread ring buffers.
+// Only the owning thread writes its buffer so markers don't lock or allocate.
+// Readers copy the buffers and drop the records overwritten while copying.
+class Profiler {
+public:
+	struct Record {
+		const char* name;
+		// Nanoseconds since the profiler start.
+		int64_t start;
+		int64_t end;
+		int depth;
+	};
+
+	struct ThreadRecords {
+		size_t threadId;
+		std::string threadName;
+		// Ordered by the end time.
+		std::vector<Record> records;
+	};
+
+	static constexpr size_t capacity = 1 << 16;
+	// Name of the scope around each main loop iteration.
+	static constexpr const char* frameName = "Frame";
+
+private:
+	struct Slot {
+		std::atomic<const char*> name;
+		std::atomic<int64_t> start;
+		std::atomic<int64_t> end;
+		std::atomic<int> depth;
+	};
+
+	struct ThreadBuffer {
+		size_t id;
+		// Guarded by the registry mutex.
+		std::string name;
+		bool isInUse = true;
+		std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(capacity);
+		// Records written since the thread started.
+		std::atomic<size_t> count = 0;
+		// Only used by the owning thread.
+		int depth = 0;
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		// Buffers outlive their threads so the last records can still be viewed.
+		// Threads started later take over the buffers of the finished ones.
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+	};
+
+	static Registry& GetRegistry() {
+		static Registry v;
+		return v;
+	}
+
+	static ThreadBuffer* AcquireBuffer() {
+		auto& registry = GetRegistry();
+		std::lock_guard lock(registry.mutex);
+
+		for (auto& b : registry.buffers)
+			if (!b->isInUse) {
+				b->isInUse = true;
+				b->depth = 0;
+				b->name = "thread " + std::to_string(b->id);
+				return b.get();
+			}
+
+		auto b = std::make_shared<ThreadBuffer>();
+		b->id = registry.buffers.size();
+		b->name = "thread " + std::to_string(b->id);
+		registry.buffers.push_back(b);
+		return b.get();
+	}
+	static ThreadBuffer& GetThreadBuffer() {
+		struct Lease {
+			ThreadBuffer* buffer = AcquireBuffer();
+			~Lease() {
+				std::lock_guard lock(GetRegistry().mutex);
+				buffer->isInUse = false;
+			}
+		};
+		thread_local Lease lease;
+		return *lease.buffer;
+	}
+
+	static void Read(const ThreadBuffer& buffer, int64_t since, std::vector<Record>& records) {
+		auto count = buffer.count.load(std::memory_order_acquire);
+		auto first = count > capacity ? count - capacity : 0;
+
+		// Newest first until the records get older than asked.
+		size_t i = count;
+		for (; i > first; i--) {
+			auto& s = buffer.slots[(i - 1) & (capacity - 1)];
+			Record r{
+				s.name.load(std::memory_order_relaxed),
+				s.start.load(std::memory_order_relaxed),
+				s.end.load(std::memory_order_relaxed),
+				s.depth.load(std::memory_order_relaxed),
+			};
+			if (r.end < since)
+				break;
+			records.push_back(r);
+		}
+		std::reverse(records.begin(), records.end());
+
+		// The owner may have lapped the oldest records while they were copied.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		auto countAfter = buffer.count.load(std::memory_order_relaxed);
+		if (auto overwritten = countAfter > capacity ? countAfter - capacity : 0; overwritten > i) {
+			auto dropped = (std::min)(overwritten - i, records.size());
+			records.erase(records.begin(), records.begin() + dropped);
+		}
+	}
+
+	static std::string Escape(const std::string& v) {
+		std::string s;
+		for (auto c : v) {
+			if (c == '"' || c == '\\')
+				s += '\\';
+			s += c;
+		}
+		return s;
+	}
+
+public:
+	static std::chrono::steady_clock::time_point GetStartTime() {
+		static auto v = std::chrono::steady_clock::now();
+		return v;
+	}
+	static int64_t Now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - GetStartTime()).count();
+	}
+
+	static constexpr bool IsEnabled() {
+		return PROFILER_ENABLED;
+	}
+
+	static void SetThreadName(const std::string& name) {
+		auto& buffer = GetThreadBuffer();
+
+		auto& registry = GetRegistry();
+		std::lock_guard lock(registry.mutex);
+		buffer.name = name;
+	}
+
+	// Returns the depth of the opened scope.
+	static int Begin() {
+		return GetThreadBuffer().depth++;
+	}
+	static void End(const char* name, int64_t start, int depth) {
+		auto end = Now();
+		auto& buffer = GetThreadBuffer();
+		buffer.depth = depth;
+
+		auto count = buffer.count.load(std::memory_order_relaxed);
+		auto& s = buffer.slots[count & (capacity - 1)];
+		s.name.store(name, std::memory_order_relaxed);
+		s.start.store(start, std::memory_order_relaxed);
+		s.end.store(end, std::memory_order_relaxed);
+		s.depth.store(depth, std::memory_order_relaxed);
+		buffer.count.store(count + 1, std::memory_order_release);
+	}
+
+	// Records of every thread that ended after the given time.
+	static std::vector<ThreadRecords> Collect(int64_t since = 0) {
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		std::vector<ThreadRecords> result;
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard lock(registry.mutex);
+
+			buffers = registry.buffers;
+			for (auto& b : buffers)
+				result.push_back(ThreadRecords{ b->id, b->name, {} });
+		}
+
+		for (size_t i = 0; i < buffers.size(); i++)
+			Read(*buffers[i], since, result[i].records);
+
+		return result;
+	}
+
+	// Writes everything in the buffers as complete events of the Chrome trace format.
+	// It can be opened in chrome://tracing or Perfetto.
+	static bool ExportChromeTrace(const fs::path& path) {
+		if (path.has_parent_path())
+			fs::create_directories(path.parent_path());
+
+		std::ofstream f(path);
+		if (!f.is_open()) {
+			Log::For<Profiler>().Error("Failed to open ", path.u8string());
+			return false;
+		}
+
+		// Microseconds with nanosecond precision.
+		f << std::fixed << std::setprecision(3);
+		f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool isFirst = true;
+		auto separate = [&] {
+			if (!isFirst)
+				f << ",\n";
+			isFirst = false;
+		};
+
+		for (auto& t : Collect()) {
+			separate();
+			f << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << t.threadId
+				<< ",\"args\":{\"name\":\"" << Escape(t.threadName) << "\"}}";
+
+			for (auto& r : t.records) {
+				separate();
+				f << "{\"name\":\"" << Escape(r.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << t.threadId
+					<< ",\"ts\":" << r.start / 1e3 << ",\"dur\":" << (r.end - r.start) / 1e3 << "}";
+			}
+		}
+		f << "]}\n";
+
+		return f.good();
+	}
+};
+
+class ProfileScope {
+	const char* name;
+	int64_t start;
+	int depth;
+public:
+	ProfileScope(const char* name) : name(name) {
+		depth = Profiler::Begin();
+		start = Profiler::Now();
+	}
+	~ProfileScope() {
+		Profiler::End(name, start, depth);
+	}
+};
+
+// Distribution of latencies in fixed buckets so percentiles
+// can be read at any time without keeping the samples.
+class LatencyHistogram {
+public:
+	static constexpr float bucketMilliseconds = 0.5f;
+	// Latencies from 250 ms on fall into the last bucket.
+	static constexpr size_t bucketCount = 500;
+
+private:
+	std::vector<uint32_t> buckets = std::vector<uint32_t>(bucketCount);
+	size_t count = 0;
+	float maxMilliseconds = 0;
+
+public:
+	void Add(float milliseconds) {
+		auto i = milliseconds < 0 ? 0 : (std::min)((size_t)(milliseconds / bucketMilliseconds), bucketCount - 1);
+		buckets[i]++;
+		count++;
+		maxMilliseconds = (std::max)(maxMilliseconds, milliseconds);
+	}
+	void Reset() {
+		std::fill(buckets.begin(), buckets.end(), 0);
+		count = 0;
+		maxMilliseconds = 0;
+	}
+
+	size_t GetCount() const {
+		return count;
+	}
+	float GetMax() const {
+		return maxMilliseconds;
+	}
+	// Upper bound of the bucket the percentile falls into.
+	// percentile is from 0 to 100.
+	float GetPercentile(float percentile) const {
+		if (count == 0)
+			return 0;
+
+		auto rank = (size_t)std::ceil(percentile / 100 * count);
+		size_t seen = 0;
+		// The last bucket has no upper bound.
+		for (size_t i = 0; i < bucketCount - 1; i++)
+			if (seen += buckets[i]; seen >= rank && seen > 0)
+				return (std::min)((i + 1) * bucketMilliseconds, maxMilliseconds);
+
+		return maxMilliseconds;
+	}
+	const std::vector<uint32_t>& GetBuckets() const {
+		return buckets;
+	}
+};
+
+// Latency of the viewer position from the camera capture to the buffer swap
+// of the first frame drawn with it. Only used by the main thread.
+class MotionToPhotonLatency {
+	using Clock = std::chrono::steady_clock;
+
+	struct Sample {
+		Clock::time_point captureTime;
+		Clock::time_point sampleTime;
+	};
+
+	StaticField(std::optional<Sample>, drawnPose)
+
+	static float Milliseconds(Clock::duration d) {
+		return std::chrono::duration<float, std::milli>(d).count();
+	}
+
+public:
+	// Capture to buffer swap.
+	StaticField(LatencyHistogram, Total)
+	// Capture to the main thread taking the pose.
+	StaticField(LatencyHistogram, CaptureToSample)
+	// Taking the pose to buffer swap.
+	StaticField(LatencyHistogram, SampleToSwap)
+
+	// The scene is about to be drawn with a new pose.
+	static void PoseSampled(Clock::time_point captureTime) {
+		drawnPose() = Sample{ captureTime, Clock::now() };
+	}
+	// The frame has been handed to the display.
+	// Returns the total latency if the frame showed a new pose.
+	static std::optional<float> FrameSwapped() {
+		if (!drawnPose())
+			return std::nullopt;
+
+		auto now = Clock::now();
+		auto total = Milliseconds(now - drawnPose()->captureTime);
+		Total().Add(total);
+		CaptureToSample().Add(Milliseconds(drawnPose()->sampleTime - drawnPose()->captureTime));
+		SampleToSwap().Add(Milliseconds(now - drawnPose()->sampleTime));
+		drawnPose().reset();
+
+		return total;
+	}
+
+	static void Reset() {
+		Total().Reset();
+		CaptureToSample().Reset();
+		SampleToSwap().Reset();
+	}
+};
+
+// Durations of the startup phases and the time to the first frame.
+// Phases may run on any thread and are written to the log as they end.
+class StartupTimer {
+	using Clock = std::chrono::steady_clock;
+
+	StaticFieldDefault(Clock::time_point, start, Clock::now())
+	StaticFieldDefault(bool, isFirstFrameDrawn, false)
+
+	static long long Milliseconds(Clock::duration d) {
+		return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+	}
+public:
+	// Measures its own lifetime.
+	class Phase {
+		const char* name;
+		Clock::time_point begin = Clock::now();
+	public:
+		Phase(const char* name) : name(name) {}
+		~Phase() {
+			auto end = Clock::now();
+			Log::For<StartupTimer>().Information(name, ": ", Milliseconds(end - begin), " ms, done at ", Milliseconds(end - start()), " ms");
+		}
+	};
+
+	static void Start() {
+		start() = Clock::now();
+	}
+	// Only the first call is logged. Called by the main thread.
+	static void FirstFrameDrawn() {
+		if (isFirstFrameDrawn())
+			return;
+
+		isFirstFrameDrawn() = true;
+		Log::For<StartupTimer>().Information("First frame: ", Milliseconds(Clock::now() - start()), " ms");
+	}
+};
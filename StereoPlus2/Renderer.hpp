@@ -3,6 +3,7 @@
 #include "DomainTypes.hpp"
 #include "GUI.hpp"
 #include "Windows.hpp"
+#include "Profiler.hpp"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -11,16 +12,10 @@
 
 using namespace std;
 
-// GL4.1 required
 class Renderer {
-	enum class Shader {
-		BrightLeft,
-		BrightRight,
-		DimLeft,
-		DimRight,
-	};
-
-	std::map<Shader, GLuint> shaders;
+	// All passes draw with one program. Only the color differs between them.
+	GLuint shader;
+	GLint colorLocation;
 
 	GLuint VAO;
 
@@ -60,7 +55,7 @@ class Renderer {
 		if (glWindow == NULL)
 			return false;
 		glfwMakeContextCurrent(glWindow);
-		glfwSwapInterval(1); // Enable vsync
+		glfwSwapInterval(Settings::SwapInterval().Get());
 
 		// Initialize OpenGL loader
 #if defined(IMGUI_IMPL_OPENGL_LOADER_GL3W)
@@ -83,28 +78,11 @@ class Renderer {
 
 	void CreateShaders()
 	{
-		std::string vertexShaderSource1	= GLLoader::ReadShader("shaders/.vert");
-		std::string fragmentShaderSource1 = GLLoader::ReadShader("shaders/.frag");
-
-		const char* vertexShaderSource = vertexShaderSource1.c_str();
-		const char* fragmentShaderSource = fragmentShaderSource1.c_str();
-		
-		// We need separate shaders to be able to set different colors.
-		// It's possible to change colors while switching between left and right but it's slow.
-		shaders[Shader::BrightLeft] = GLLoader::CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
-		shaders[Shader::BrightRight] = GLLoader::CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
-		shaders[Shader::DimLeft] = GLLoader::CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
-		shaders[Shader::DimRight] = GLLoader::CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
-
-		UpdateShaderColor(shaders[Shader::BrightLeft], Settings::ColorLeft().Get(), "myColor");
-		UpdateShaderColor(shaders[Shader::BrightRight], Settings::ColorRight().Get(), "myColor");
-		UpdateShaderColor(shaders[Shader::DimLeft], Settings::DimmedColorLeft().Get(), "myColor");
-		UpdateShaderColor(shaders[Shader::DimRight], Settings::DimmedColorRight().Get(), "myColor");
-	}
+		std::string vertexShaderSource = GLLoader::ReadShader("shaders/.vert");
+		std::string fragmentShaderSource = GLLoader::ReadShader("shaders/.frag");
 
-	void UpdateShaderColor(GLuint shader, glm::vec4 color, const char* name) {
-		// Available since GL4.1
-		glProgramUniform4f(shader, glGetUniformLocation(shader, name), color.r, color.g, color.b, color.a);
+		shader = GLLoader::CreateShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		colorLocation = glGetUniformLocation(shader, "myColor");
 	}
 
 	//void DrawSquare(const WhiteSquare& square) {
@@ -121,8 +99,14 @@ class Renderer {
 	//	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 	//}
 
-	void DrawWithShader(Camera* camera, std::vector<PON>& os, GLuint shader, std::function<void(SceneObject*, GLuint)> drawFunc) {
+	// Setting a uniform between the passes is cheaper than switching programs.
+	void UseShader(const glm::vec4& color) {
 		glUseProgram(shader);
+		glUniform4f(colorLocation, color.r, color.g, color.b, color.a);
+	}
+
+	void DrawWithShader(Camera* camera, std::vector<PON>& os, const glm::vec4& color, std::function<void(SceneObject*, GLuint)> drawFunc) {
+		UseShader(color);
 		for (auto& o : os) {
 			o->UdateBuffer(
 				[&camera](const glm::vec3& p) { return camera->GetLeft(p); },
@@ -131,8 +115,8 @@ class Renderer {
 			drawFunc(o.Get(), shader);
 		}
 	}
-	void DrawWithShader(Camera* camera, SceneObject* o, GLuint shader, std::function<void(SceneObject*, GLuint)> drawFunc) {
-		glUseProgram(shader);
+	void DrawWithShader(Camera* camera, SceneObject* o, const glm::vec4& color, std::function<void(SceneObject*, GLuint)> drawFunc) {
+		UseShader(color);
 
 		o->UdateBuffer(
 			[&camera](const glm::vec3& p) { return camera->GetLeft(p); },
@@ -148,6 +132,7 @@ public:
 	glm::vec4 backgroundColor = glm::vec4(0, 0, 0, 0);
 
 	void Pipeline(Scene& scene) {
+		PROFILE_SCOPE("Renderer::Pipeline");
 		glDisable(GL_DEPTH_TEST);
 		glClearColor(backgroundColor.r, backgroundColor.g, backgroundColor.b, backgroundColor.a);
 
@@ -169,11 +154,11 @@ public:
 		glBlendFuncSeparate(GL_SRC_ALPHA, GL_DST_ALPHA, GL_ONE, GL_ONE);
 
 		if (ObjectSelection::Selected().empty()) {
-			DrawWithShader(scene.camera, scene.Objects().Get(), shaders[Shader::BrightLeft], [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
-			DrawWithShader(scene.camera, scene.Objects().Get(), shaders[Shader::BrightRight], [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
+			DrawWithShader(scene.camera, scene.Objects().Get(), Settings::ColorLeft().Get(), [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
+			DrawWithShader(scene.camera, scene.Objects().Get(), Settings::ColorRight().Get(), [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
 			
-			DrawWithShader(scene.camera, &scene.cross().Get(), shaders[Shader::BrightLeft], [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
-			DrawWithShader(scene.camera, &scene.cross().Get(), shaders[Shader::BrightRight], [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
+			DrawWithShader(scene.camera, &scene.cross().Get(), Settings::ColorLeft().Get(), [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
+			DrawWithShader(scene.camera, &scene.cross().Get(), Settings::ColorRight().Get(), [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
 		}
 		else {
 			std::set<PON> objectsSorted;
@@ -193,14 +178,14 @@ public:
 				if (o.HasValue())
 					selectedExistent.push_back(o);
 
-			DrawWithShader(scene.camera, dimObjects, shaders[Shader::DimLeft], [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
-			DrawWithShader(scene.camera, dimObjects, shaders[Shader::DimRight], [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
+			DrawWithShader(scene.camera, dimObjects, Settings::DimmedColorLeft().Get(), [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
+			DrawWithShader(scene.camera, dimObjects, Settings::DimmedColorRight().Get(), [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
 			
-			DrawWithShader(scene.camera, selectedExistent, shaders[Shader::BrightLeft], [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
-			DrawWithShader(scene.camera, selectedExistent, shaders[Shader::BrightRight], [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
+			DrawWithShader(scene.camera, selectedExistent, Settings::ColorLeft().Get(), [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
+			DrawWithShader(scene.camera, selectedExistent, Settings::ColorRight().Get(), [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
 
-			DrawWithShader(scene.camera, &scene.cross().Get(), shaders[Shader::BrightLeft], [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
-			DrawWithShader(scene.camera, &scene.cross().Get(), shaders[Shader::BrightRight], [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
+			DrawWithShader(scene.camera, &scene.cross().Get(), Settings::ColorLeft().Get(), [](SceneObject* o, GLuint shader) { o->DrawLeft(shader); });
+			DrawWithShader(scene.camera, &scene.cross().Get(), Settings::ColorRight().Get(), [](SceneObject* o, GLuint shader) { o->DrawRight(shader); });
 		}
 
 		// Anti aliasing
@@ -212,15 +197,21 @@ public:
 	}
 
 	bool Init() {
-		if (!InitGL())
-			return false;
+		{
+			StartupTimer::Phase phase("Window and OpenGL");
+			if (!InitGL())
+				return false;
+		}
 
 		GLint lineWidthRange[2];
 		glGetIntegerv(GL_ALIASED_LINE_WIDTH_RANGE, lineWidthRange);
 		Settings::MinLineThickness() = lineWidthRange[0];
 		Settings::MaxLineThickness() = lineWidthRange[1];
 
-		CreateShaders();
+		{
+			StartupTimer::Phase phase("Shaders");
+			CreateShaders();
+		}
 
 		// Not sure what exactly Vertex Array Object is.
 		// From what I understand it's related to index order in objects.
@@ -229,16 +220,14 @@ public:
 		glGenVertexArrays(1, &VAO);
 		glBindVertexArray(VAO);
 
-		Settings::ColorLeft().OnChanged() += [&](glm::vec4 color) { UpdateShaderColor(shaders[Shader::BrightLeft], color, "myColor"); };
-		Settings::ColorRight().OnChanged() += [&](glm::vec4 color) { UpdateShaderColor(shaders[Shader::BrightRight], color, "myColor"); };
-		Settings::DimmedColorLeft().OnChanged() += [&](glm::vec4 color) { UpdateShaderColor(shaders[Shader::DimLeft], color, "myColor"); };
-		Settings::DimmedColorRight().OnChanged() += [&](glm::vec4 color) { UpdateShaderColor(shaders[Shader::DimRight], color, "myColor"); };
+		Settings::SwapInterval().OnChanged() += [](int v) { glfwSwapInterval(v); };
 
 		return true;
 	}
 
 	bool OnExit() {
 		glDeleteVertexArrays(1, &VAO);
+		glDeleteProgram(shader);
 		return true;
 	}
 };
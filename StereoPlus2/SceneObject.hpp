@@ -1,6 +1,9 @@
 #pragma once
 #include "GLLoader.hpp"
 #include "Settings.hpp"
+#include "Profiler.hpp"
+#include "FrameScheduler.hpp"
+#include "MemoryUsage.hpp"
 #include <stack>
 
 enum ObjectType {
@@ -50,6 +53,10 @@ protected:
 	// When true cache will be updated on reading.
 	// Means the object was changed.
 	bool shouldUpdateCache = true;
+	// When true the object will be written to the change journal
+	// on the next autosave. Unlike shouldUpdateCache it's only set
+	// when saved data changes, not when the view changes.
+	bool shouldSaveChanges = true;
 	const float propertyIndent = -20;
 
 	virtual void HandleBeforeUpdate() {
@@ -61,15 +68,20 @@ protected:
 			isTriggered = true;
 			onBeforeAnyElementChanged().Invoke();
 
-			(new FuncCommand())->func = [&] {
+			FuncCommand::Post([&] {
 				isTriggered = false;
-			};
+			});
 		}
 	}
 	virtual void UpdateOpenGLBuffer(
 		std::function<glm::vec3(glm::vec3)> toLeft,
 		std::function<glm::vec3(glm::vec3)> toRight) {}
 
+	template<typename T>
+	static void CountObject(const T* o, MemoryUsage::SceneBytes& bytes) {
+		bytes.objects += sizeof(T) + MemoryUsage::Of(o->Name) + MemoryUsage::Of(o->children);
+	}
+
 
 	// Adds or substracts transformations.
 
@@ -124,6 +136,13 @@ public:
 		isAnyElementChanged() = false;
 	}
 
+	bool ShouldSaveChanges() const {
+		return shouldSaveChanges;
+	}
+	void ResetShouldSaveChanges() {
+		shouldSaveChanges = false;
+	}
+
 	StaticFieldDefault(std::stack<bool>, isDeletionExpected, std::stack<bool>(std::deque<bool>({ true })))
 
 	SceneObject() {
@@ -140,7 +159,7 @@ public:
 		children = copy->children;
 		Name = copy->Name;
 	}
-	~SceneObject() {
+	virtual ~SceneObject() {
 		glDeleteBuffers(2, &VBOLeft);
 
 		if (!isDeletionExpected().empty() && !isDeletionExpected().top())
@@ -150,6 +169,7 @@ public:
 	void UdateBuffer(std::function<glm::vec3(glm::vec3)> toLeft,
 		std::function<glm::vec3(glm::vec3)> toRight) {
 		if (shouldUpdateCache || Settings::ShouldDetectPosition().Get()) {
+			PROFILE_SCOPE("SceneObject::UdateBuffer");
 			UpdateOpenGLBuffer(toLeft, toRight);
 			shouldUpdateCache = false;
 		}
@@ -167,6 +187,7 @@ public:
 	}
 	void SetParent(SceneObject* newParent, int newParentPos, InsertPosition pos) {
 		ForceUpdateCache();
+		shouldSaveChanges = true;
 		auto source = &parent->children;
 		auto dest = &newParent->children;
 
@@ -212,6 +233,7 @@ public:
 		bool shouldUpdateNewParent = true) {
 		if (shouldForceUpdateCache)
 			ForceUpdateCache();
+		shouldSaveChanges = true;
 
 		if (!shouldIgnoreOldParent && parent && parent->children.size() > 0) {
 			auto pos = std::find(parent->children.begin(), parent->children.end(), this);
@@ -265,10 +287,12 @@ public:
 	}
 	void SetLocalPosition(const glm::vec3& v) {
 		ForceUpdateCache();
+		shouldSaveChanges = true;
 		position = v;
 	}
 	void SetWorldPosition(const glm::vec3& v) {
 		ForceUpdateCache();
+		shouldSaveChanges = true;
 
 		position = shouldTransformPosition && GetParent()
 			// Set world position means to set local position
@@ -287,10 +311,12 @@ public:
 	}
 	void SetLocalRotation(const glm::quat& v) {
 		ForceUpdateCache();
+		shouldSaveChanges = true;
 		rotation = v;
 	}
 	void SetWorldRotation(const glm::quat& v) {
 		ForceUpdateCache();
+		shouldSaveChanges = true;
 
 		rotation = shouldTransformRotation && GetParent()
 			// Set world rotation means to set local rotation
@@ -302,6 +328,7 @@ public:
 	// Forces the object and all children to update cache.
 	void ForceUpdateCache() {
 		HandleBeforeUpdate();
+		FrameScheduler::RequestRedraw();
 
 		shouldUpdateCache = true;
 		for (auto c : children)
@@ -358,6 +385,7 @@ public:
 	// Clears the object.
 	virtual void Reset() {
 		ForceUpdateCache();
+		shouldSaveChanges = true;
 	}
 
 	void CallRecursive(std::function<void(SceneObject*)> f) {
@@ -372,7 +400,11 @@ public:
 			c->CallRecursive(t, f);
 	}
 
-	virtual SceneObject* Clone() const { throw std::exception("not implemented"); }
+	virtual SceneObject* Clone() const { throw std::runtime_error("not implemented"); }
+	// Adds the memory held by the object to the count.
+	virtual void CountMemory(MemoryUsage::SceneBytes& bytes) const {
+		CountObject(this, bytes);
+	}
 	SceneObject& operator=(const SceneObject& o) {
 		position = o.position;
 		rotation = o.rotation;
@@ -450,7 +482,7 @@ public:
 
 	SceneObject* Get() const {
 		if (!node)
-			throw new std::exception("PON doesn't have value");
+			throw new std::runtime_error("PON doesn't have value");
 
 		return node->object;
 	}
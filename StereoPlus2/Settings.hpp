@@ -69,6 +69,19 @@ public:
 	StaticProperty(float, PPI)
 	StaticProperty(bool, IsAutosaveEnabled)
 	StaticProperty(int, AutosavePeriodMinutes)
+	StaticProperty(bool, IsCompactFileEncodingEnabled)
+	StaticProperty(float, FilePrecisionMillimeters)
+	StaticProperty(bool, IsFileCompressionEnabled)
+	// Draw frames only when something has changed.
+	StaticProperty(bool, IsRenderOnDemandEnabled)
+	// Draw the scene right before the frame is swapped
+	// so it shows the newest viewer position.
+	StaticProperty(bool, IsLowLatencyModeEnabled)
+	// Vertical blanks to wait for before a swap. 0 disables vsync.
+	// Settings files without it keep vsync on.
+	StaticPropertyDefault(int, SwapInterval, 1)
+	// Frames the GPU may lag behind the main loop. 0 leaves it to the driver.
+	StaticProperty(int, MaxQueuedFrames)
 
 	StaticProperty(bool, UseDiscreteMovement)
 	StaticProperty(float, TranslationStep)
@@ -96,58 +109,103 @@ public:
 
 	StaticProperty(float, FaceSizeYMillimeters)
 	StaticProperty(glm::vec3, ScreenCenterToCameraDistanceMillimeters)
+	StaticProperty(int, PositionDetectionThreadCount)
+	StaticProperty(int, PositionDetectionFrameHeight)
+	StaticProperty(bool, IsFaceTrackingEnabled)
+	StaticProperty(int, FullFaceDetectionPeriod)
+	StaticProperty(float, PoseFilterMinCutoff)
+	StaticProperty(float, PoseFilterBeta)
+	StaticProperty(float, PosePredictionMilliseconds)
+	StaticProperty(std::string, PositionDetectionSource)
+	StaticProperty(std::string, FaceDetectorBackend)
+	StaticProperty(bool, IsMotionGatingEnabled)
+	StaticProperty(float, MotionGateThreshold)
+	StaticProperty(std::string, PoseProvider)
+	StaticProperty(int, ExternalPosePort)
+	StaticProperty(std::string, ExternalPoseSharedMemoryName)
 
 
 	// Readonly system fields
 	StaticField(int, MinLineThickness)
 	StaticField(int, MaxLineThickness)
 
+	// Settings are referenced by their accessor functions.
+	template<typename F>
+	static const std::string& Name(F* reference) {
+		return Name((void*)reference);
+	}
 	static const std::string& Name(void* reference) {
 		static std::map<void*, const std::string> v = {
-			{&Language,"language"},
-			{&StateBufferLength,"stateBufferLength"},
-			{&LogFileName,"logFileName"},
-			{&PPI,"ppi"},
-			{&IsAutosaveEnabled,"isAutosaveEnabled"},
-			{&AutosavePeriodMinutes,"autosavePeriodMinutes"},
-
-			{&UseDiscreteMovement,"useDiscreteMovement"},
-			{&TranslationStep,"translationStep"},
-			{&RotationStep,"rotationStep"},
-			{&ScalingStep,"scalingStep"},
-			{&MouseSensivity,"mouseSensivity"},
-
-			{&RotationStep,"rotationStep"},
-			{&ScalingStep,"scalingStep"},
-
-			{&ColorLeft,"colorLeft"},
-			{&ColorRight,"colorRight"},
-			{&DimmedColorLeft,"dimmedColorLeft"},
-			{&DimmedColorRight,"dimmedColorRight"},
-			{&CustomRenderWindowAlpha,"customRenderWindowAlpha"},
-
-			{&ShouldMoveCrossOnCosinePenModeChange,"shouldMoveCrossOnCosinePenModeChange"},
-
-			{&PointRadiusPixel,"pointRadiusPixel"},
-			{&LineThickness,"lineThickness"},
-
-			{&CosinePointCount,"cosinePointCount"},
-
-			{&CameraResolution,"cameraResolution"},
-			{&CameraViewAngles,"cameraViewAngles"},
-			{&CameraAngle,"cameraAngle"},
-			{&FaceSizeYMillimeters,"faceSizeYMillimeters"},
-			{&ScreenCenterToCameraDistanceMillimeters,"screenCenterToCameraDistanceMillimeters"},
+			{(void*)&Language,"language"},
+			{(void*)&StateBufferLength,"stateBufferLength"},
+			{(void*)&LogFileName,"logFileName"},
+			{(void*)&PPI,"ppi"},
+			{(void*)&IsAutosaveEnabled,"isAutosaveEnabled"},
+			{(void*)&AutosavePeriodMinutes,"autosavePeriodMinutes"},
+			{(void*)&IsCompactFileEncodingEnabled,"isCompactFileEncodingEnabled"},
+			{(void*)&FilePrecisionMillimeters,"filePrecisionMillimeters"},
+			{(void*)&IsFileCompressionEnabled,"isFileCompressionEnabled"},
+			{(void*)&IsRenderOnDemandEnabled,"isRenderOnDemandEnabled"},
+			{(void*)&IsLowLatencyModeEnabled,"isLowLatencyModeEnabled"},
+			{(void*)&SwapInterval,"swapInterval"},
+			{(void*)&MaxQueuedFrames,"maxQueuedFrames"},
+
+			{(void*)&UseDiscreteMovement,"useDiscreteMovement"},
+			{(void*)&TranslationStep,"translationStep"},
+			{(void*)&RotationStep,"rotationStep"},
+			{(void*)&ScalingStep,"scalingStep"},
+			{(void*)&MouseSensivity,"mouseSensivity"},
+
+			{(void*)&RotationStep,"rotationStep"},
+			{(void*)&ScalingStep,"scalingStep"},
+
+			{(void*)&ColorLeft,"colorLeft"},
+			{(void*)&ColorRight,"colorRight"},
+			{(void*)&DimmedColorLeft,"dimmedColorLeft"},
+			{(void*)&DimmedColorRight,"dimmedColorRight"},
+			{(void*)&CustomRenderWindowAlpha,"customRenderWindowAlpha"},
+
+			{(void*)&ShouldMoveCrossOnCosinePenModeChange,"shouldMoveCrossOnCosinePenModeChange"},
+
+			{(void*)&PointRadiusPixel,"pointRadiusPixel"},
+			{(void*)&LineThickness,"lineThickness"},
+
+			{(void*)&CosinePointCount,"cosinePointCount"},
+
+			{(void*)&CameraResolution,"cameraResolution"},
+			{(void*)&CameraViewAngles,"cameraViewAngles"},
+			{(void*)&CameraAngle,"cameraAngle"},
+			{(void*)&FaceSizeYMillimeters,"faceSizeYMillimeters"},
+			{(void*)&ScreenCenterToCameraDistanceMillimeters,"screenCenterToCameraDistanceMillimeters"},
+			{(void*)&PositionDetectionThreadCount,"positionDetectionThreadCount"},
+			{(void*)&PositionDetectionFrameHeight,"positionDetectionFrameHeight"},
+			{(void*)&IsFaceTrackingEnabled,"isFaceTrackingEnabled"},
+			{(void*)&FullFaceDetectionPeriod,"fullFaceDetectionPeriod"},
+			{(void*)&PoseFilterMinCutoff,"poseFilterMinCutoff"},
+			{(void*)&PoseFilterBeta,"poseFilterBeta"},
+			{(void*)&PosePredictionMilliseconds,"posePredictionMilliseconds"},
+			{(void*)&PositionDetectionSource,"positionDetectionSource"},
+			{(void*)&FaceDetectorBackend,"faceDetectorBackend"},
+			{(void*)&IsMotionGatingEnabled,"isMotionGatingEnabled"},
+			{(void*)&MotionGateThreshold,"motionGateThreshold"},
+			{(void*)&PoseProvider,"poseProvider"},
+			{(void*)&ExternalPosePort,"externalPosePort"},
+			{(void*)&ExternalPoseSharedMemoryName,"externalPoseSharedMemoryName"},
 		};
 
 		if (auto a = v.find(reference); a != v.end())
-			return a._Ptr->_Myval.second;
+			return a->second;
 		
-		throw new std::exception("Name for a reference was not found.");
+		throw new std::runtime_error("Name for a reference was not found.");
 	}
 
 };
 
 struct ReadOnlyState {
 	StaticProperty(glm::vec2, ViewSize)
+	// Time from the camera capture of the viewer position
+	// to the buffer swap of the first frame drawn with it.
+	StaticProperty(float, PoseLatencyMilliseconds)
+	// Localization key of the position detection state.
+	StaticProperty(std::string, PositionDetectionStatus)
 };
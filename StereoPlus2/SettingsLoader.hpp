@@ -1,6 +1,8 @@
 #pragma once
 #include "FileManager.hpp"
 #include "Localization.hpp"
+#include "ExternalPose.hpp"
+#include "FaceDetection.hpp"
 
 class SettingsLoader {
 	static std::map<std::string, std::string>& settings() {
@@ -13,35 +15,36 @@ class SettingsLoader {
 		return v;
 	}
 
-	static void LoadJson(const std::string& key, Js::ObjectAbstract* joa) {
+	static void LoadJson(const std::string& key, const Jv::ObjectAbstract* joa) {
 		switch (joa->GetType()) {
-		case Js::JPrimitiveString:
+		case Jv::JPrimitiveString:
 		{
-			auto v = (Js::PrimitiveString*)joa;
+			auto v = (const Jv::PrimitiveString*)joa;
 
 			settings()[key] = v->value;
 			break;
 		}
-		case Js::JPrimitive:
+		case Jv::JPrimitive:
 		{
-			auto v = (Js::Primitive*)joa;
+			auto v = (const Jv::Primitive*)joa;
 
 			settings()[key] = v->value;
 			break;
 		}
-		case Js::JObject:
+		case Jv::JObject:
 		{
-			for (auto [k, v] : ((Js::Object*)joa)->objects)
-				LoadJson(key + ":" + k, v);
+			for (auto& [k, v] : *(const Jv::Object*)joa)
+				LoadJson(key + ":" + std::string(k), v);
 
 			break;
 		}
-		case Js::JArray:
+		case Jv::JArray:
 		{
-			for (size_t i = 0; i < ((Js::Array*)joa)->objects.size(); i++) {
+			auto a = (const Jv::Array*)joa;
+			for (size_t i = 0; i < a->size; i++) {
 				std::stringstream ss;
 				ss << i;
-				LoadJson(key + ":" + ss.str(), ((Js::Array*)joa)->objects[i]);
+				LoadJson(key + ":" + ss.str(), (*a)[i]);
 			}
 
 			break;
@@ -52,21 +55,14 @@ class SettingsLoader {
 		}
 	}
 	static void LoadSettings(std::string name) {
-		Js::Object* json = nullptr;
 		try {
-			json = (Js::Object*)Json::Read(name);
+			auto json = Json::Read(name);
 
-			for (auto [k, v] : json->objects)
-				LoadJson(k, v);
-
-			delete json;
+			for (auto& [k, v] : *(const Jv::Object*)json->Root())
+				LoadJson(std::string(k), v);
 		}
 		catch (std::exception & e) {
 			Logger().Error("Settings could not be loaded.");
-
-			if (json)
-				delete json;
-
 			throw;
 		}
 	}
@@ -80,13 +76,12 @@ class SettingsLoader {
 		}
 
 		std::stringstream ss;
-		ss << node._Ptr->_Myval.second;
+		ss << node->second;
 		T v;
 		ss >> v;
 
 		setter(v);
 	}
-	template<>
 	static void Load(const std::string& name, std::function<void(glm::vec4)> setter) {
 		static const int size = sizeof(glm::vec4) / sizeof(float);
 
@@ -100,7 +95,7 @@ class SettingsLoader {
 				Logger().Error("Failed to load setting: ", name, ":", i);
 				return;
 			}
-			nodes[i] = node._Ptr->_Myval.second;
+			nodes[i] = node->second;
 		}
 		
 		glm::vec4 v;
@@ -113,7 +108,6 @@ class SettingsLoader {
 		setter(v);
 	}
 
-	template<>
 	static void Load(const std::string& name, std::function<void(glm::vec3)> setter) {
 		static const int size = sizeof(glm::vec3) / sizeof(float);
 
@@ -127,7 +121,7 @@ class SettingsLoader {
 				Logger().Error("Failed to load setting: ", name, ":", i);
 				return;
 			}
-			nodes[i] = node._Ptr->_Myval.second;
+			nodes[i] = node->second;
 		}
 
 		glm::vec3 v;
@@ -140,7 +134,6 @@ class SettingsLoader {
 		setter(v);
 	}
 
-	template<>
 	static void Load(const std::string& name, std::function<void(glm::vec2)> setter) {
 		static const int size = sizeof(glm::vec2) / sizeof(float);
 
@@ -154,7 +147,7 @@ class SettingsLoader {
 				Logger().Error("Failed to load setting: ", name, ":", i);
 				return;
 			}
-			nodes[i] = node._Ptr->_Myval.second;
+			nodes[i] = node->second;
 		}
 
 		glm::vec2 v;
@@ -190,6 +183,47 @@ class SettingsLoader {
 		// Cannot be less than 1.
 		if (Settings::AutosavePeriodMinutes().Get() < 1)
 			Settings::AutosavePeriodMinutes() = 1;
+		// Must be positive.
+		if (!(Settings::FilePrecisionMillimeters().Get() > 0))
+			Settings::FilePrecisionMillimeters() = 0.01;
+		// Cannot be less than 1.
+		if (Settings::PositionDetectionThreadCount().Get() < 1)
+			Settings::PositionDetectionThreadCount() = 1;
+		// Cannot be negative.
+		if (Settings::FullFaceDetectionPeriod().Get() < 0)
+			Settings::FullFaceDetectionPeriod() = 0;
+		// Must be positive.
+		if (!(Settings::PoseFilterMinCutoff().Get() > 0))
+			Settings::PoseFilterMinCutoff() = 1;
+		// Cannot be negative.
+		if (Settings::PoseFilterBeta().Get() < 0)
+			Settings::PoseFilterBeta() = 0;
+		// Cannot be negative.
+		if (Settings::PosePredictionMilliseconds().Get() < 0)
+			Settings::PosePredictionMilliseconds() = 0;
+		// Cannot be negative.
+		if (Settings::MotionGateThreshold().Get() < 0)
+			Settings::MotionGateThreshold() = 0;
+		// Empty in settings files written before the backends.
+		// Backends without their files installed aren't offered either.
+		if (!FaceDetector::IsAvailable(Settings::FaceDetectorBackend().Get()))
+			Settings::FaceDetectorBackend() = FaceDetectorBackend::Haar;
+		// Empty in settings files written before external poses.
+		if (auto v = Settings::PoseProvider().Get();
+			v != PoseProvider::Camera && v != PoseProvider::Udp && v != PoseProvider::SharedMemory)
+			Settings::PoseProvider() = PoseProvider::Camera;
+		// Must be a valid UDP port.
+		if (Settings::ExternalPosePort().Get() < 1 || Settings::ExternalPosePort().Get() > 65535)
+			Settings::ExternalPosePort() = 27182;
+		// Cannot be negative.
+		if (Settings::PositionDetectionFrameHeight().Get() < 0)
+			Settings::PositionDetectionFrameHeight() = 0;
+		// Cannot be negative.
+		if (Settings::SwapInterval().Get() < 0)
+			Settings::SwapInterval() = 1;
+		// Cannot be negative.
+		if (Settings::MaxQueuedFrames().Get() < 0)
+			Settings::MaxQueuedFrames() = 0;
 	}
 public:
 	
@@ -202,6 +236,13 @@ public:
 		Load(&Settings::PPI);
 		Load(&Settings::IsAutosaveEnabled);
 		Load(&Settings::AutosavePeriodMinutes);
+		Load(&Settings::IsCompactFileEncodingEnabled);
+		Load(&Settings::FilePrecisionMillimeters);
+		Load(&Settings::IsFileCompressionEnabled);
+		Load(&Settings::IsRenderOnDemandEnabled);
+		Load(&Settings::IsLowLatencyModeEnabled);
+		Load(&Settings::SwapInterval);
+		Load(&Settings::MaxQueuedFrames);
 
 		Load(&Settings::UseDiscreteMovement);
 		Load(&Settings::TranslationStep);
@@ -227,6 +268,20 @@ public:
 		Load(&Settings::CameraAngle);
 		Load(&Settings::FaceSizeYMillimeters);
 		Load(&Settings::ScreenCenterToCameraDistanceMillimeters);
+		Load(&Settings::PositionDetectionThreadCount);
+		Load(&Settings::PositionDetectionFrameHeight);
+		Load(&Settings::IsFaceTrackingEnabled);
+		Load(&Settings::FullFaceDetectionPeriod);
+		Load(&Settings::PoseFilterMinCutoff);
+		Load(&Settings::PoseFilterBeta);
+		Load(&Settings::PosePredictionMilliseconds);
+		Load(&Settings::PositionDetectionSource);
+		Load(&Settings::FaceDetectorBackend);
+		Load(&Settings::IsMotionGatingEnabled);
+		Load(&Settings::MotionGateThreshold);
+		Load(&Settings::PoseProvider);
+		Load(&Settings::ExternalPosePort);
+		Load(&Settings::ExternalPoseSharedMemoryName);
 
 		VerifySettings();
 	}
@@ -239,6 +294,13 @@ public:
 		Insert(json, &Settings::PPI);
 		Insert(json, &Settings::IsAutosaveEnabled);
 		Insert(json, &Settings::AutosavePeriodMinutes);
+		Insert(json, &Settings::IsCompactFileEncodingEnabled);
+		Insert(json, &Settings::FilePrecisionMillimeters);
+		Insert(json, &Settings::IsFileCompressionEnabled);
+		Insert(json, &Settings::IsRenderOnDemandEnabled);
+		Insert(json, &Settings::IsLowLatencyModeEnabled);
+		Insert(json, &Settings::SwapInterval);
+		Insert(json, &Settings::MaxQueuedFrames);
 
 		Insert(json, &Settings::UseDiscreteMovement);
 		Insert(json, &Settings::TranslationStep);
@@ -264,6 +326,20 @@ public:
 		Insert(json, &Settings::CameraAngle);
 		Insert(json, &Settings::FaceSizeYMillimeters);
 		Insert(json, &Settings::ScreenCenterToCameraDistanceMillimeters);
+		Insert(json, &Settings::PositionDetectionThreadCount);
+		Insert(json, &Settings::PositionDetectionFrameHeight);
+		Insert(json, &Settings::IsFaceTrackingEnabled);
+		Insert(json, &Settings::FullFaceDetectionPeriod);
+		Insert(json, &Settings::PoseFilterMinCutoff);
+		Insert(json, &Settings::PoseFilterBeta);
+		Insert(json, &Settings::PosePredictionMilliseconds);
+		Insert(json, &Settings::PositionDetectionSource);
+		Insert(json, &Settings::FaceDetectorBackend);
+		Insert(json, &Settings::IsMotionGatingEnabled);
+		Insert(json, &Settings::MotionGateThreshold);
+		Insert(json, &Settings::PoseProvider);
+		Insert(json, &Settings::ExternalPosePort);
+		Insert(json, &Settings::ExternalPoseSharedMemoryName);
 
 		Json::Write("settings.json", &json);
 	}
@@ -10,6 +10,7 @@
 #include <queue>
 #include "TemplateExtensions.hpp"
 #include "Settings.hpp"
+#include "Profiler.hpp"
 #include "Math.hpp"
 #include "Localization.hpp"
 
@@ -265,6 +266,7 @@ class PenTool : public EditingTool {
 	}
 
 	void ProcessInput() {
+		PROFILE_SCOPE("PenTool::ProcessInput");
 		if (!target.HasValue()) {
 			UnbindSceneObjects();
 			return;
@@ -287,11 +289,12 @@ class PenTool : public EditingTool {
 		createNewObjectHandlerId = Input::AddHandler([&] {
 			if (Input::IsDown(Key::Enter, true) || Input::IsDown(Key::NEnter, true)) {
 				lockCreateNewObjectHandlerId = true;
+				PROFILE_SCOPE("PenTool::CreateObject");
 
 				auto cmd = new CreateCommand();
 
 				if (ObjectSelection::Selected().size() == 1) {
-					auto d = ObjectSelection::Selected().begin()._Ptr->_Myval.Get();
+					auto d = ObjectSelection::Selected().begin()->Get();
 					cmd->destination = d->GetParent() ? const_cast<SceneObject*>(d->GetParent()) : d;
 				}
 
@@ -339,7 +342,7 @@ class PenTool : public EditingTool {
 			return;
 		}
 
-		auto t = targets.begin()._Ptr->_Myval;
+		auto t = *targets.begin();
 
 		if (t->GetType() != PolyLineT)
 			return TryCreateNewObject();
@@ -670,6 +673,7 @@ class ExtrusionEditingTool : public EditingToolConfigured<ExtrusionEditingToolMo
 	}
 
 	void ProcessInput() {
+		PROFILE_SCOPE("ExtrusionEditingTool::ProcessInput");
 		switch (mode)
 		{
 		case Mode::Immediate:
@@ -875,6 +879,7 @@ class TransformTool : public EditingTool {
 
 
 	void ProcessInput(const ObjectType& type, const Mode& mode) {
+		PROFILE_SCOPE("TransformTool::ProcessInput");
 		if (!shouldTrace && Input::HasContinuousMovementInputNoDelayStopped() && SceneObject::IsAnyElementChanged()) {
 			Changes::Commit();
 			SceneObject::ResetIsAnyElementChanged();
@@ -1176,6 +1181,7 @@ class CosinePenTool : public EditingTool {
 	}
 
 	void ProcessInput() {
+		PROFILE_SCOPE("CosinePenTool::ProcessInput");
 		if (!target.HasValue()) {
 			UnbindSceneObjects();
 			return;
@@ -1198,11 +1204,12 @@ class CosinePenTool : public EditingTool {
 		createNewObjectHandlerId = Input::AddHandler([&] {
 			if (Input::IsDown(Key::Enter, true) || Input::IsDown(Key::NEnter, true)) {
 				lockCreateNewObjectHandlerId = true;
+				PROFILE_SCOPE("CosinePenTool::CreateObject");
 
 				auto cmd = new CreateCommand();
 
 				if (ObjectSelection::Selected().size() == 1) {
-					auto d = ObjectSelection::Selected().begin()._Ptr->_Myval.Get();
+					auto d = ObjectSelection::Selected().begin()->Get();
 					cmd->destination = d->GetParent() ? const_cast<SceneObject*>(d->GetParent()) : d;
 				}
 
@@ -1250,7 +1257,7 @@ class CosinePenTool : public EditingTool {
 			return;
 		}
 
-		auto& t = targets.begin()._Ptr->_Myval;
+		auto& t = *targets.begin();
 
 		if (t->GetType() != SineCurveT)
 			return TryCreateNewObject();
@@ -1400,11 +1407,12 @@ class PointPenTool : public EditingTool {
 		createNewObjectHandlerId = Input::AddHandler([&] {
 			if (Input::IsDown(Key::Enter, true) || Input::IsDown(Key::NEnter, true)) {
 				lockCreateNewObjectHandlerId = true;
+				PROFILE_SCOPE("PointPenTool::CreateObject");
 
 				auto cmd = new CreateCommand();
 
 				if (ObjectSelection::Selected().size() == 1) {
-					auto d = ObjectSelection::Selected().begin()._Ptr->_Myval.Get();
+					auto d = ObjectSelection::Selected().begin()->Get();
 					cmd->destination = d->GetParent() ? const_cast<SceneObject*>(d->GetParent()) : d;
 				}
 
@@ -1452,7 +1460,7 @@ class PointPenTool : public EditingTool {
 			return;
 		}
 
-		auto t = targets.begin()._Ptr->_Myval;
+		auto t = *targets.begin();
 
 		if (t->GetType() != PointT)
 			return TryCreateNewObject();
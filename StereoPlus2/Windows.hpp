@@ -11,10 +11,13 @@
 #include <string>
 #include "include/imgui/imgui_stdlib.h"
 #include "FileManager.hpp"
+#include "FaceDetection.hpp"
 #include "TemplateExtensions.hpp"
 #include "InfrastructureTypes.hpp"
 #include "Localization.hpp"
 #include "ImGuiExtensions.hpp"
+#include "Profiler.hpp"
+#include "FrameScheduler.hpp"
 #include "include/stb/stb_image_write.h"
 
 
@@ -170,6 +173,18 @@ public:
 		return onResize;
 	}
 
+	// Draws the scene into the texture shown by the window.
+	bool RenderScene() {
+		RenderToFileAdvanced();
+		bindFrameBuffer(fbo, RenderSize->x, RenderSize->y);
+		if (!customRenderFunc())
+			return false;
+		RenderToFileBasic();
+		unbindCurrentFrameBuffer(RenderSize->x, RenderSize->y);
+
+		return true;
+	}
+
 	virtual bool Init() {
 		Window::name = "renderWindow";
 		createFrameBuffer();
@@ -209,12 +224,9 @@ public:
 		ImGui::PopStyleColor(2);
 		ImGui::PopStyleVar();
 
-		RenderToFileAdvanced();
-		bindFrameBuffer(fbo, RenderSize->x, RenderSize->y);
-		if (!customRenderFunc())
+		// In low latency mode the GUI draws the scene right before the swap.
+		if (!Settings::IsLowLatencyModeEnabled().Get() && !RenderScene())
 			return false;
-		RenderToFileBasic();
-		unbindCurrentFrameBuffer(RenderSize->x, RenderSize->y);
 
 		ImGui::PushStyleColor(ImGuiCol_Button, glm::vec4());
 		ImGui::PushStyleColor(ImGuiCol_ButtonHovered, glm::vec4());
@@ -1742,6 +1754,8 @@ class SettingsWindow : Window {
 		if (auto v = (&settingReference())->Get();
 			field(LocaleProvider::GetC(Settings::Name(settingReference)), v)) {
 			*(&settingReference()) = v;
+			// Colors, line thickness and other settings change the look of the scene.
+			FrameScheduler::RequestRedraw();
 			if (shouldForceUpdateCache)
 				Scene::root().Get()->ForceUpdateCache();
 
@@ -1762,6 +1776,7 @@ class SettingsWindow : Window {
 		if (auto v = (&settingReference())->Get();
 			field(LocaleProvider::GetC(prefix + Settings::Name(settingReference)), v)) {
 			*(&settingReference()) = v;
+			FrameScheduler::RequestRedraw();
 			if (shouldForceUpdateCache)
 				Scene::root().Get()->ForceUpdateCache();
 
@@ -1840,7 +1855,7 @@ public:
 			if (Settings::IsAutosaveEnabled().Get()) {
 				auto autosaveCommand = new AutosaveCommand();
 				autosaveCommand->SetFunc([filename = AutosaveCommand::GetFileName()] {
-					FileManager::Save(filename, Scene::scene());
+					FileManager::SaveChangesAsync(filename, Scene::scene());
 					});
 				autosaveCommand->StartNew(Settings::AutosavePeriodMinutes().Get());
 			}
@@ -1869,15 +1884,57 @@ public:
 
 				auto autosaveCommand = new AutosaveCommand();
 				autosaveCommand->SetFunc([filename = AutosaveCommand::GetFileName()] {
-					FileManager::Save(filename, Scene::scene());
+					FileManager::SaveChangesAsync(filename, Scene::scene());
 					});
 				autosaveCommand->StartNew(Settings::AutosavePeriodMinutes().Get());
 			}
+
+			if (auto bytes = FileManager::LastSaveBytes().load(); bytes > 0)
+				ImGui::LabelText(LocaleProvider::GetC("lastAutosave"), "%.1f ms, %.1f KB",
+					FileManager::LastSaveDurationMicroseconds().load() / 1e3f, bytes / 1024.f);
+		}
+
+		SettingField(&Settings::IsCompactFileEncodingEnabled, std::function([](const char* name, bool& v)
+			{ return ImGui::Checkbox(name, &v); }));
+
+		if (Settings::IsCompactFileEncodingEnabled().Get()) {
+			SettingField(&Settings::FilePrecisionMillimeters, std::function([](const char* name, float& v)
+				{
+					auto res = ImGui::InputFloat(name, &v, 0.01, 0.1, "%.3f");
+					if (v < 0.001)
+						v = 0.001;
+					return res;
+				}));
+
+			SettingField(&Settings::IsFileCompressionEnabled, std::function([](const char* name, bool& v)
+				{ return ImGui::Checkbox(name, &v); }));
 		}
 
 		SettingField(&Settings::StateBufferLength, std::function([](const char* name, int& v)
 			{ return ImGui::InputInt(name, &v, 1, 10, 4); }));
 
+		SettingField(&Settings::IsRenderOnDemandEnabled, std::function([](const char* name, bool& v)
+			{ return ImGui::Checkbox(name, &v); }));
+
+		SettingField(&Settings::IsLowLatencyModeEnabled, std::function([](const char* name, bool& v)
+			{ return ImGui::Checkbox(name, &v); }));
+
+		SettingField(&Settings::SwapInterval, std::function([](const char* name, int& v)
+			{
+				auto res = ImGui::InputInt(name, &v);
+				if (v < 0) v = 0;
+				return res;
+			}));
+
+		SettingField(&Settings::MaxQueuedFrames, std::function([](const char* name, int& v)
+			{
+				auto res = ImGui::InputInt(name, &v);
+				if (v < 0) v = 0;
+				ImGui::SameLine();
+				ImGui::Extensions::HelpMarker(LocaleProvider::GetC("maxQueuedFramesToolTip"));
+				return res;
+			}));
+
 
 		SettingField(&Settings::LogFileName, std::function([](const char* name, std::string& v) 
 			{ return ImGui::InputText(name, &v); }));
@@ -1915,6 +1972,98 @@ public:
 			SettingField("webcam:", &Settings::ScreenCenterToCameraDistanceMillimeters, std::function([](const char* name, glm::vec3& v)
 				{ return ImGui::InputFloat3(name, (float*)&v, "%.0f"); }));
 
+			// Applied when position detection starts.
+			SettingField("webcam:", &Settings::PositionDetectionThreadCount, std::function([](const char* name, int& v)
+				{
+					auto res = ImGui::InputInt(name, &v);
+					if (v < 1) v = 1;
+					return res;
+				}));
+
+			SettingField("webcam:", &Settings::PositionDetectionFrameHeight, std::function([](const char* name, int& v)
+				{
+					auto res = ImGui::InputInt(name, &v);
+					if (v < 0) v = 0;
+					ImGui::SameLine();
+					ImGui::Extensions::HelpMarker(LocaleProvider::GetC("webcam:positionDetectionFrameHeightToolTip"));
+					return res;
+				}));
+
+			// Applied when position detection starts.
+			if (auto v = Settings::FaceDetectorBackend().Get();
+				ImGui::TreeNode((LocaleProvider::Get("webcam:" + Settings::Name(&Settings::FaceDetectorBackend)) + ": " + LocaleProvider::Get("webcam:" + v)).c_str())) {
+
+				// Backends without their files installed aren't offered.
+				for (auto& backend : FaceDetectorBackend::All)
+					if (auto i = v == backend; FaceDetector::IsAvailable(backend) && ImGui::Selectable(LocaleProvider::GetC("webcam:" + backend), &i))
+						Settings::FaceDetectorBackend() = backend;
+
+				ImGui::TreePop();
+			}
+
+			SettingField("webcam:", &Settings::IsFaceTrackingEnabled, std::function([](const char* name, bool& v)
+				{ return ImGui::Checkbox(name, &v); }));
+
+			if (Settings::IsFaceTrackingEnabled().Get())
+				SettingField("webcam:", &Settings::FullFaceDetectionPeriod, std::function([](const char* name, int& v)
+					{
+						auto res = ImGui::InputInt(name, &v);
+						if (v < 0) v = 0;
+						return res;
+					}));
+
+			SettingField("webcam:", &Settings::IsMotionGatingEnabled, std::function([](const char* name, bool& v)
+				{ return ImGui::Checkbox(name, &v); }));
+
+			if (Settings::IsMotionGatingEnabled().Get())
+				SettingField("webcam:", &Settings::MotionGateThreshold, std::function([](const char* name, float& v)
+					{
+						auto res = ImGui::InputFloat(name, &v, 0.1, 1, "%.1f");
+						if (v < 0) v = 0;
+						return res;
+					}));
+
+			SettingField("webcam:", &Settings::PoseFilterMinCutoff, std::function([](const char* name, float& v)
+				{
+					auto res = ImGui::InputFloat(name, &v, 0.1, 1, "%.2f");
+					if (v < 0.01) v = 0.01;
+					return res;
+				}));
+
+			SettingField("webcam:", &Settings::PoseFilterBeta, std::function([](const char* name, float& v)
+				{
+					auto res = ImGui::InputFloat(name, &v, 0.001, 0.01, "%.3f");
+					if (v < 0) v = 0;
+					return res;
+				}));
+
+			SettingField("webcam:", &Settings::PosePredictionMilliseconds, std::function([](const char* name, float& v)
+				{
+					auto res = ImGui::InputFloat(name, &v, 1, 10, "%.0f");
+					if (v < 0) v = 0;
+					return res;
+				}));
+
+			// Applied when position detection starts.
+			SettingField("webcam:", &Settings::PositionDetectionSource, std::function([](const char* name, std::string& v)
+				{
+					auto res = ImGui::InputText(name, &v);
+					ImGui::SameLine();
+					ImGui::Extensions::HelpMarker(LocaleProvider::GetC("webcam:positionDetectionSourceToolTip"));
+					return res;
+				}));
+
+			SettingField("webcam:", &Settings::ExternalPosePort, std::function([](const char* name, int& v)
+				{
+					auto res = ImGui::InputInt(name, &v);
+					if (v < 1) v = 1;
+					if (v > 65535) v = 65535;
+					return res;
+				}));
+
+			SettingField("webcam:", &Settings::ExternalPoseSharedMemoryName, std::function([](const char* name, std::string& v)
+				{ return ImGui::InputText(name, &v); }));
+
 			ImGui::TreePop();
 		}
 
@@ -1941,6 +2090,297 @@ public:
 
 };
 
+// Per stage timings of the recent frames and the frame time distribution
+// from the profiler markers of every thread.
+class ProfilerWindow : Window {
+	const Log log = Log::For<ProfilerWindow>();
+
+	struct Stage {
+		std::string name;
+		int depth = 0;
+		size_t callCount = 0;
+		double totalMilliseconds = 0;
+		double maxMilliseconds = 0;
+	};
+	struct ThreadStages {
+		std::string name;
+		std::vector<Stage> stages;
+	};
+
+	// The overlay would be unreadable if it changed every frame.
+	static constexpr auto updatePeriod = std::chrono::milliseconds(500);
+	static constexpr auto statisticsPeriod = std::chrono::seconds(2);
+	static constexpr int frameTimeBucketCount = 50;
+
+	std::chrono::steady_clock::time_point lastUpdate;
+	std::vector<float> frameTimes;
+	std::vector<float> frameTimeBuckets = std::vector<float>(frameTimeBucketCount);
+	float frameTimeBucketMilliseconds = 1;
+	std::vector<ThreadStages> threads;
+	std::string exportedPath;
+	// Motion-to-photon latency distribution up to the slowest pose.
+	std::vector<float> latencyBuckets;
+
+	void Update() {
+		auto periodNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(statisticsPeriod).count();
+		auto records = Profiler::Collect(Profiler::Now() - periodNanoseconds);
+
+		frameTimes.clear();
+		threads.clear();
+		for (auto& t : records) {
+			if (t.records.empty())
+				continue;
+
+			// Parents before children so the stages read as a tree.
+			std::sort(t.records.begin(), t.records.end(),
+				[](const Profiler::Record& a, const Profiler::Record& b) { return a.start < b.start || a.start == b.start && a.depth < b.depth; });
+
+			auto& thread = threads.emplace_back();
+			thread.name = t.threadName;
+			for (auto& r : t.records) {
+				auto milliseconds = (r.end - r.start) / 1e6;
+
+				if (!strcmp(r.name, Profiler::frameName))
+					frameTimes.push_back(milliseconds);
+
+				auto stage = std::find_if(thread.stages.begin(), thread.stages.end(),
+					[&r](const Stage& s) { return s.depth == r.depth && s.name == r.name; });
+				if (stage == thread.stages.end())
+					stage = thread.stages.insert(thread.stages.end(), Stage{ r.name, r.depth });
+
+				stage->callCount++;
+				stage->totalMilliseconds += milliseconds;
+				stage->maxMilliseconds = (std::max)(stage->maxMilliseconds, milliseconds);
+			}
+		}
+
+		// Buckets stretch over the slowest frame.
+		std::fill(frameTimeBuckets.begin(), frameTimeBuckets.end(), 0.f);
+		auto maxFrameTime = frameTimes.empty() ? 0.f : *std::max_element(frameTimes.begin(), frameTimes.end());
+		frameTimeBucketMilliseconds = (std::max)(1.f, std::ceil(maxFrameTime / frameTimeBucketCount));
+		for (auto t : frameTimes)
+			frameTimeBuckets[(std::min)((int)(t / frameTimeBucketMilliseconds), frameTimeBucketCount - 1)]++;
+
+		auto& buckets = MotionToPhotonLatency::Total().GetBuckets();
+		auto usedBucketCount = (std::min)((size_t)(MotionToPhotonLatency::Total().GetMax() / LatencyHistogram::bucketMilliseconds) + 1, buckets.size());
+		latencyBuckets.assign(buckets.begin(), buckets.begin() + usedBucketCount);
+	}
+
+	void DesignLatency() {
+		if (!ImGui::CollapsingHeader(LocaleProvider::GetC("profiler:latency"), ImGuiTreeNodeFlags_DefaultOpen))
+			return;
+
+		if (MotionToPhotonLatency::Total().GetCount() == 0) {
+			ImGui::TextWrapped("%s", LocaleProvider::GetC("profiler:noLatency"));
+			return;
+		}
+
+		auto width = ImGui::GetContentRegionAvail().x;
+		char bucketText[128];
+		snprintf(bucketText, sizeof(bucketText), "%s, %.1f ms", LocaleProvider::GetC("profiler:latencyDistribution"), LatencyHistogram::bucketMilliseconds);
+		ImGui::PlotHistogram("", latencyBuckets.data(), latencyBuckets.size(), 0, bucketText, 0, FLT_MAX, glm::vec2(width, 60));
+
+		if (ImGui::BeginTable("latency", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ColumnsWidthFixed)) {
+			ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:stage"), ImGuiTableColumnFlags_WidthStretch);
+			for (auto name : { "p50", "p90", "p99", "max" })
+				ImGui::TableSetupColumn(name);
+			ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:poseCount"));
+			ImGui::TableHeadersRow();
+
+			for (auto [name, histogram] : {
+				std::pair("profiler:captureToSwap", &MotionToPhotonLatency::Total()),
+				std::pair("profiler:captureToSample", &MotionToPhotonLatency::CaptureToSample()),
+				std::pair("profiler:sampleToSwap", &MotionToPhotonLatency::SampleToSwap()),
+				}) {
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", LocaleProvider::GetC(name));
+				for (auto percentile : { 50.f, 90.f, 99.f }) {
+					ImGui::TableNextColumn();
+					ImGui::Text("%.1f", histogram->GetPercentile(percentile));
+				}
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", histogram->GetMax());
+				ImGui::TableNextColumn();
+				ImGui::Text("%zu", histogram->GetCount());
+			}
+
+			ImGui::EndTable();
+		}
+
+		if (ImGui::Button(LocaleProvider::GetC("profiler:resetLatency")))
+			MotionToPhotonLatency::Reset();
+	}
+
+	void DesignStages(const ThreadStages& thread) {
+		auto seconds = std::chrono::duration<double>(statisticsPeriod).count();
+
+		if (!ImGui::BeginTable(thread.name.c_str(), 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ColumnsWidthFixed))
+			return;
+
+		ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:stage"), ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:callsPerSecond"));
+		ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:averageMilliseconds"));
+		ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:maxMilliseconds"));
+		ImGui::TableSetupColumn(LocaleProvider::GetC("profiler:load"));
+		ImGui::TableHeadersRow();
+
+		for (auto& s : thread.stages) {
+			ImGui::TableNextColumn();
+			ImGui::Text("%*s%s", s.depth * 2, "", s.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", s.callCount / seconds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", s.totalMilliseconds / s.callCount);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", s.maxMilliseconds);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", s.totalMilliseconds / 10 / seconds);
+		}
+
+		ImGui::EndTable();
+	}
+
+public:
+	Property<bool> IsOpen;
+
+	virtual bool Init() {
+		Window::name = "profilerWindow";
+
+		return true;
+	}
+	virtual bool Design() {
+		if (!IsOpen.Get())
+			return true;
+
+		auto windowName = LocaleProvider::Get(Window::name) + "###" + Window::name;
+		if (!ImGui::Begin(windowName.c_str(), &IsOpen.Get())) {
+			ImGui::End();
+			return true;
+		}
+
+		if (auto now = std::chrono::steady_clock::now(); now - lastUpdate > updatePeriod) {
+			lastUpdate = now;
+			Update();
+		}
+
+		// Latency is measured without the timing markers.
+		if (!Profiler::IsEnabled()) {
+			ImGui::TextWrapped("%s", LocaleProvider::GetC("profiler:disabled"));
+			DesignLatency();
+			ImGui::End();
+			return true;
+		}
+
+		auto width = ImGui::GetContentRegionAvail().x;
+		ImGui::PlotLines("", frameTimes.data(), frameTimes.size(), 0, LocaleProvider::GetC("profiler:frameTime"), 0, FLT_MAX, glm::vec2(width, 60));
+
+		auto bucketText = std::string(LocaleProvider::Get("profiler:frameTimeDistribution")) + ", " + std::to_string((int)frameTimeBucketMilliseconds) + " ms";
+		ImGui::PlotHistogram("", frameTimeBuckets.data(), frameTimeBuckets.size(), 0, bucketText.c_str(), 0, FLT_MAX, glm::vec2(width, 60));
+
+		for (auto& t : threads)
+			if (ImGui::CollapsingHeader(t.name.c_str(), ImGuiTreeNodeFlags_DefaultOpen))
+				DesignStages(t);
+
+		DesignLatency();
+
+		if (ImGui::Button(LocaleProvider::GetC("profiler:exportTrace"))) {
+			auto path = fs::path("profiles") / ("trace" + Time::GetTimeFormatted("%Y%m%d%H%M%S") + ".json");
+			if (Profiler::ExportChromeTrace(path))
+				exportedPath = fs::absolute(path).u8string();
+		}
+		if (!exportedPath.empty())
+			ImGui::TextWrapped("%s %s", LocaleProvider::GetC("profiler:exported"), exportedPath.c_str());
+
+		ImGui::End();
+		return true;
+	}
+	virtual bool OnExit() {
+		return true;
+	}
+};
+
+// Bytes held by each subsystem and their high-water marks.
+class MemoryWindow : Window {
+	const Log log = Log::For<MemoryWindow>();
+
+	std::string dumpedPath;
+
+	// Writes the report to the log and to a file next to the profiles.
+	void Dump() {
+		Scene::CountMemory();
+
+		std::stringstream report;
+		MemoryUsage::WriteReport(report);
+		log.Information("Memory usage\n", report.str());
+
+		auto path = fs::path("profiles") / ("memory" + Time::GetTimeFormatted("%Y%m%d%H%M%S") + ".txt");
+		fs::create_directories(path.parent_path());
+
+		std::ofstream f(path);
+		if (!f.is_open()) {
+			log.Error("Failed to open ", path.u8string());
+			return;
+		}
+
+		f << report.str();
+		dumpedPath = fs::absolute(path).u8string();
+	}
+
+	static void DesignRow(const char* name, int64_t current, int64_t peak) {
+		ImGui::TableNextColumn();
+		ImGui::Text("%s", name);
+		ImGui::TableNextColumn();
+		ImGui::Text("%s", MemoryUsage::Format(current).c_str());
+		ImGui::TableNextColumn();
+		ImGui::Text("%s", MemoryUsage::Format(peak).c_str());
+	}
+
+public:
+	Property<bool> IsOpen;
+
+	virtual bool Init() {
+		Window::name = "memoryWindow";
+
+		return true;
+	}
+	virtual bool Design() {
+		if (!IsOpen.Get())
+			return true;
+
+		auto windowName = LocaleProvider::Get(Window::name) + "###" + Window::name;
+		if (!ImGui::Begin(windowName.c_str(), &IsOpen.Get())) {
+			ImGui::End();
+			return true;
+		}
+
+		if (ImGui::BeginTable("memory", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ColumnsWidthFixed)) {
+			ImGui::TableSetupColumn(LocaleProvider::GetC("memory:category"), ImGuiTableColumnFlags_WidthStretch);
+			ImGui::TableSetupColumn(LocaleProvider::GetC("memory:current"));
+			ImGui::TableSetupColumn(LocaleProvider::GetC("memory:peak"));
+			ImGui::TableHeadersRow();
+
+			for (size_t i = 0; i < MemoryUsage::categoryCount; i++) {
+				auto category = (MemoryUsage::Category)i;
+				DesignRow(LocaleProvider::GetC(std::string("memory:") + MemoryUsage::GetName(category)), MemoryUsage::GetCurrent(category), MemoryUsage::GetPeak(category));
+			}
+			DesignRow(LocaleProvider::GetC("memory:total"), MemoryUsage::GetTotal(), MemoryUsage::GetTotalPeak());
+
+			ImGui::EndTable();
+		}
+
+		if (ImGui::Button(LocaleProvider::GetC("memory:dump")))
+			Dump();
+		if (!dumpedPath.empty())
+			ImGui::TextWrapped("%s %s", LocaleProvider::GetC("memory:dumped"), dumpedPath.c_str());
+
+		ImGui::End();
+		return true;
+	}
+	virtual bool OnExit() {
+		return true;
+	}
+};
+
 class LogWindow : Window {
 	const Log log = Log::For<LogWindow>();
 public:
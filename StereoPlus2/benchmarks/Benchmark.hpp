@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Runs named cases for each of their sizes and reports the time of a run.
+// Results can be written as JSON or CSV to compare them between commits.
+//
+// Options:
+//   --filter=text                    Cases with the text in their name only.
+//   --sizes=a,b,c                    Sizes to run every case with instead of its own.
+//   --min-time=seconds               Minimum measured time of a size, 0.5 by default.
+//   --format=console|json|csv        Console by default.
+//   --output=file                    Standard output by default.
+//   --label=text                     Written with every result, e.g. the commit.
+class Benchmark {
+public:
+	// Prepares the state for a size outside the measured time
+	// and returns the measured function which returns the count of processed items.
+	using Setup = std::function<std::function<size_t()>(size_t size)>;
+
+	struct Result {
+		std::string name;
+		size_t size;
+		size_t runCount;
+		size_t itemCount;
+		double medianNanoseconds;
+		double minNanoseconds;
+		double maxNanoseconds;
+	};
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Case {
+		std::string name;
+		std::vector<size_t> sizes;
+		Setup setup;
+	};
+
+	struct Options {
+		std::string filter;
+		std::vector<size_t> sizes;
+		double minSeconds = 0.5;
+		std::string format = "console";
+		std::string output;
+		std::string label;
+	};
+
+	static constexpr size_t minRunCount = 3;
+	static constexpr size_t maxRunCount = 10000;
+
+	static std::vector<Case>& cases() {
+		static std::vector<Case> v;
+		return v;
+	}
+
+	static void WriteUsage(std::ostream& out) {
+		out << "Options:\n"
+			<< "  --filter=text                    Cases with the text in their name only.\n"
+			<< "  --sizes=a,b,c                    Sizes to run every case with instead of its own.\n"
+			<< "  --min-time=seconds               Minimum measured time of a size, 0.5 by default.\n"
+			<< "  --format=console|json|csv        Console by default.\n"
+			<< "  --output=file                    Standard output by default.\n"
+			<< "  --label=text                     Written with every result, e.g. the commit.\n";
+	}
+
+	static bool ParseOptions(int argc, char** argv, Options& options) {
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto separator = arg.find('=');
+			auto key = arg.substr(0, separator);
+			auto value = separator == std::string::npos ? "" : arg.substr(separator + 1);
+
+			try {
+				if (key == "--filter")
+					options.filter = value;
+				else if (key == "--sizes") {
+					std::stringstream ss(value);
+					for (std::string size; std::getline(ss, size, ',');)
+						options.sizes.push_back(std::stoull(size));
+				}
+				else if (key == "--min-time")
+					options.minSeconds = std::stod(value);
+				else if (key == "--format" && (value == "console" || value == "json" || value == "csv"))
+					options.format = value;
+				else if (key == "--output")
+					options.output = value;
+				else if (key == "--label")
+					options.label = value;
+				else {
+					std::cerr << "Unknown option " << arg << std::endl;
+					WriteUsage(std::cerr);
+					return false;
+				}
+			}
+			// Thrown by the number conversions.
+			catch (const std::exception&) {
+				std::cerr << "Invalid value for " << key << std::endl;
+				WriteUsage(std::cerr);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static Result Measure(const std::string& name, size_t size, const Setup& setup, double minSeconds) {
+		auto run = setup(size);
+
+		// Warm up.
+		auto itemCount = run();
+
+		std::vector<double> samples;
+		double total = 0;
+		while (samples.size() < maxRunCount && (samples.size() < minRunCount || total < minSeconds)) {
+			auto start = Clock::now();
+			itemCount = run();
+			auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			samples.push_back(seconds * 1e9);
+			total += seconds;
+		}
+
+		std::sort(samples.begin(), samples.end());
+		return { name, size, samples.size(), itemCount, samples[samples.size() / 2], samples.front(), samples.back() };
+	}
+
+	static std::string Escape(const std::string& v) {
+		std::string s;
+		for (auto c : v) {
+			if (c == '"' || c == '\\')
+				s += '\\';
+			s += c;
+		}
+		return s;
+	}
+
+	static double ItemsPerSecond(const Result& r) {
+		return r.itemCount / r.medianNanoseconds * 1e9;
+	}
+
+	static void WriteConsole(std::ostream& out, const Result& r) {
+		out << std::left << std::setw(40) << r.name
+			<< std::right << std::setw(10) << r.size
+			<< std::setw(14) << std::fixed << std::setprecision(3) << r.medianNanoseconds / 1e6 << " ms"
+			<< std::setw(14) << std::setprecision(2) << ItemsPerSecond(r) / 1e6 << " M items/s"
+			<< std::setw(8) << r.runCount << " runs" << std::endl;
+	}
+	static void WriteCsv(std::ostream& out, const Options& options, const std::vector<Result>& results) {
+		out << "label,name,size,runs,items,median_ns,min_ns,max_ns,items_per_second\n";
+		for (auto& r : results)
+			out << '"' << options.label << "\",\"" << r.name << "\"," << r.size << ',' << r.runCount << ',' << r.itemCount << ','
+				<< std::fixed << std::setprecision(1) << r.medianNanoseconds << ',' << r.minNanoseconds << ',' << r.maxNanoseconds << ','
+				<< ItemsPerSecond(r) << '\n';
+	}
+	static void WriteJson(std::ostream& out, const Options& options, const std::vector<Result>& results) {
+		out << "{\"label\":\"" << Escape(options.label) << "\",\"results\":[";
+		for (size_t i = 0; i < results.size(); i++) {
+			auto& r = results[i];
+			out << (i ? ",\n" : "\n")
+				<< "{\"name\":\"" << Escape(r.name) << "\",\"size\":" << r.size
+				<< ",\"runs\":" << r.runCount << ",\"items\":" << r.itemCount
+				<< std::fixed << std::setprecision(1)
+				<< ",\"medianNs\":" << r.medianNanoseconds << ",\"minNs\":" << r.minNanoseconds << ",\"maxNs\":" << r.maxNanoseconds
+				<< ",\"itemsPerSecond\":" << ItemsPerSecond(r) << "}";
+		}
+		out << "\n]}\n";
+	}
+
+public:
+	static void Add(const std::string& name, const std::vector<size_t>& sizes, const Setup& setup) {
+		cases().push_back({ name, sizes, setup });
+	}
+
+	// Keeps the compiler from removing the computation of the value.
+	template<typename T>
+	static void Keep(const T& v) {
+		static volatile unsigned char sink;
+		sink = sink + *(const volatile unsigned char*)&v;
+	}
+
+	static int Run(int argc, char** argv) {
+		Options options;
+		if (!ParseOptions(argc, argv, options))
+			return 1;
+
+		std::vector<Result> results;
+		for (auto& c : cases()) {
+			if (c.name.find(options.filter) == std::string::npos)
+				continue;
+
+			for (auto size : options.sizes.empty() ? c.sizes : options.sizes) {
+				results.push_back(Measure(c.name, size, c.setup, options.minSeconds));
+				// Progress goes to the console whatever the format.
+				WriteConsole(options.format == "console" && options.output.empty() ? std::cout : std::cerr, results.back());
+			}
+		}
+
+		if (options.format == "console")
+			return 0;
+
+		std::ofstream file;
+		if (!options.output.empty()) {
+			file.open(options.output);
+			if (!file.is_open()) {
+				std::cerr << "Failed to open " << options.output << std::endl;
+				return 1;
+			}
+		}
+		auto& out = options.output.empty() ? std::cout : file;
+
+		if (options.format == "json")
+			WriteJson(out, options, results);
+		else
+			WriteCsv(out, options, results);
+
+		return out.good() ? 0 : 1;
+	}
+};
@@ -0,0 +1,138 @@
+// Commands per second through Command::ExecuteAll.
+// The list based queue the commands used to have is measured alongside
+// for comparison, including with persistent commands waiting in it.
+//
+// Usage: CommandQueueBenchmark [commands per frame = 1000] [frame count = 1000] [producer thread count = 4]
+
+#include "../InfrastructureTypes.hpp"
+#include <iostream>
+
+using Clock = std::chrono::steady_clock;
+
+// The previous implementation of Command reduced to the queue handling.
+class ListCommand {
+	static std::list<ListCommand*>& GetQueue() {
+		static auto queue = std::list<ListCommand*>();
+		return queue;
+	}
+public:
+	bool isReady = true;
+	bool mustPersist = false;
+	std::function<void()> func;
+
+	ListCommand() {
+		GetQueue().push_back(this);
+	}
+	static void ExecuteAll() {
+		std::list<ListCommand*> deleteQueue;
+		for (auto command : GetQueue())
+			if (command->isReady) {
+				command->func();
+
+				if (!command->mustPersist)
+					deleteQueue.push_back(command);
+			}
+
+		for (auto command : deleteQueue) {
+			GetQueue().remove(command);
+			delete command;
+		}
+	}
+};
+
+class PersistentCommand : Command {
+protected:
+	virtual bool Execute() {
+		return true;
+	}
+public:
+	PersistentCommand() {
+		isReady = true;
+		mustPersist = true;
+	}
+};
+
+size_t executedCount = 0;
+
+template<typename F>
+void Report(const char* name, size_t commandCount, F f) {
+	auto start = Clock::now();
+	f();
+	auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+	std::cout << name << ": " << commandCount / seconds / 1e6 << " M commands/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	size_t perFrame = 1000;
+	size_t frameCount = 1000;
+	size_t producerCount = 4;
+	try {
+		if (argc > 1)
+			perFrame = std::stoull(argv[1]);
+		if (argc > 2)
+			frameCount = std::stoull(argv[2]);
+		if (argc > 3)
+			producerCount = std::stoull(argv[3]);
+	}
+	// Not a number. Reported with the usage like a zero count.
+	catch (const std::exception&) {
+		producerCount = 0;
+	}
+	// Without producers nothing is posted and the threaded run waits forever.
+	if (perFrame == 0 || frameCount == 0 || producerCount == 0) {
+		std::cout << "Usage: CommandQueueBenchmark [commands per frame] [frame count] [producer thread count]" << std::endl;
+		return 1;
+	}
+	size_t total = perFrame * frameCount;
+
+	auto postFrames = [&] {
+		for (size_t f = 0; f < frameCount; f++) {
+			for (size_t i = 0; i < perFrame; i++)
+				FuncCommand::Post([] { executedCount++; });
+			Command::ExecuteAll();
+		}
+	};
+	auto listFrames = [&] {
+		for (size_t f = 0; f < frameCount; f++) {
+			for (size_t i = 0; i < perFrame; i++)
+				(new ListCommand())->func = [] { executedCount++; };
+			ListCommand::ExecuteAll();
+		}
+	};
+
+	// Fill the pool.
+	postFrames();
+
+	Report("pooled queue", total, postFrames);
+	Report("list", total, listFrames);
+
+	// Timers and similar commands stay in the queue.
+	for (int i = 0; i < 100; i++) {
+		new PersistentCommand();
+		auto c = new ListCommand();
+		c->mustPersist = true;
+		c->func = [] {};
+	}
+	Report("pooled queue, 100 persistent", total, postFrames);
+	Report("list, 100 persistent", total, listFrames);
+
+	// Worker threads post while the main thread executes.
+	auto before = executedCount;
+	Report("pooled queue, posted from threads", total, [&] {
+		std::vector<std::thread> producers;
+		for (size_t t = 0; t < producerCount; t++)
+			producers.emplace_back([&, t] {
+				for (size_t i = t; i < total; i += producerCount)
+					FuncCommand::Post([] { executedCount++; });
+			});
+
+		while (executedCount - before < total)
+			Command::ExecuteAll();
+
+		for (auto& p : producers)
+			p.join();
+	});
+
+	return executedCount - before == total ? 0 : 1;
+}
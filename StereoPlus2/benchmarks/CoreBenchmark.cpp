@@ -0,0 +1,260 @@
+// Hot paths of the domain code without a window or GL context:
+// stereo projection, curve generation, cascading transforms,
+// so2 and json round trips, undo and moving objects in the hierarchy.
+// Build with STEREOPLUS2_HEADLESS so the GL calls do nothing.
+//
+// Usage: CoreBenchmark [--filter=text] [--sizes=a,b,c] [--min-time=seconds]
+//                      [--format=console|json|csv] [--output=file] [--label=text]
+// See Benchmark.hpp for the options.
+
+#include "../FileManager.hpp"
+#include "Benchmark.hpp"
+#include <random>
+
+#ifndef SCENES_DIRECTORY
+#define SCENES_DIRECTORY "scenes"
+#endif
+
+std::vector<glm::vec3> RandomVertices(size_t count) {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> coordinate(-100, 100);
+
+	std::vector<glm::vec3> vertices(count);
+	for (auto& v : vertices)
+		v = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+	return vertices;
+}
+
+// Replaces the scene content with a new root.
+// The objects of the previous content are deleted with the last reference.
+GroupObject* ResetScene() {
+	Changes::Clear();
+	Scene::Objects().Get().clear();
+
+	auto root = new GroupObject();
+	Scene::root() = root;
+	return root;
+}
+
+// A group that moves and rotates its children like the cross does.
+class TransformProbe : public GroupObject {
+public:
+	TransformProbe() {
+		shouldTransformPosition = true;
+		shouldTransformRotation = true;
+	}
+	using SceneObject::CascadeTransform;
+};
+
+std::vector<char> ReadFile(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+		throw std::runtime_error("Failed to open " + filename);
+
+	std::vector<char> buffer(file.tellg());
+	file.seekg(0);
+	file.read(buffer.data(), buffer.size());
+	return buffer;
+}
+
+void DeleteDecoded(SceneObject* root, const std::vector<SceneObject*>& objects) {
+	for (auto o : objects)
+		delete o;
+	delete root;
+}
+
+// Copies of the flower scene under one root.
+struct Flowers {
+	SceneObject* root = new GroupObject();
+	std::vector<SceneObject*> objects;
+
+	Flowers(size_t count) {
+		auto file = ReadFile(SCENES_DIRECTORY "/flower.so2");
+
+		for (size_t i = 0; i < count; i++) {
+			ibstream str;
+			auto flower = str.setBuffer(file.data()).get<SceneObject*>();
+			flower->SetParent(root);
+			objects.push_back(flower);
+			objects.insert(objects.end(), str.objects.begin(), str.objects.end());
+		}
+	}
+	~Flowers() {
+		DeleteDecoded(root, objects);
+	}
+};
+
+void AddProjection(Camera& camera) {
+	Benchmark::Add("Stereo::GetLeft/GetRight", { 1000, 100000, 1000000 }, [&camera](size_t size) {
+		return [&camera, vertices = RandomVertices(size)] {
+			glm::vec3 sum(0);
+			for (auto& v : vertices)
+				sum += camera.GetLeft(v) + camera.GetRight(v);
+			Benchmark::Keep(sum);
+			return vertices.size();
+		};
+	});
+}
+
+void AddCurves() {
+	// The size is the CosinePointCount setting.
+	Benchmark::Add("Build::Sine", { 10, 100, 1000 }, [](size_t size) {
+		Settings::CosinePointCount() = (int)size;
+		return [] {
+			static const glm::vec3 vertices[3] = { glm::vec3(0), glm::vec3(30, 50, 10), glm::vec3(100, 0, -20) };
+			auto points = Build::Sine(vertices);
+			Benchmark::Keep(points.back());
+			return points.size();
+		};
+	});
+	Benchmark::Add("Build::Circle", { 100, 10000, 1000000 }, [](size_t size) {
+		return [size] {
+			auto points = Build::Circle(size, 50);
+			Benchmark::Keep(points.back());
+			return points.size();
+		};
+	});
+}
+
+void AddTransforms() {
+	// The size is the hierarchy depth above 10000 transformed vertices.
+	Benchmark::Add("SceneObject::CascadeTransform", { 1, 4, 16, 64 }, [](size_t size) {
+		auto root = ResetScene();
+		SceneObject* parent = root;
+		for (size_t i = 0; i < size; i++) {
+			auto group = new TransformProbe();
+			group->SetLocalPosition(glm::vec3(i, 1, 0));
+			group->SetLocalRotation(glm::angleAxis(0.1f, glm::vec3(0, 0, 1)));
+			Scene::Insert(parent, group);
+			parent = group;
+		}
+		auto probe = new TransformProbe();
+		Scene::Insert(parent, probe);
+
+		return [probe, source = RandomVertices(10000), vertices = std::vector<glm::vec3>()]() mutable {
+			vertices = source;
+			probe->CascadeTransform(vertices);
+			Benchmark::Keep(vertices.back());
+			return vertices.size();
+		};
+	});
+}
+
+void AddSerialization() {
+	// The size is the count of flower copies. Items are objects.
+	Benchmark::Add("so2 round trip flower", { 1, 10, 100 }, [](size_t size) {
+		return [flowers = std::make_shared<Flowers>(size)] {
+			obstream out;
+			out.put(ObjectSnapshot::Take(*flowers->root));
+			auto buffer = out.releaseBuffer();
+
+			ibstream in;
+			auto copy = in.setBuffer(buffer.data()).get<SceneObject*>();
+			DeleteDecoded(copy, in.objects);
+			return flowers->objects.size() + 1;
+		};
+	});
+	Benchmark::Add("json round trip flower", { 1, 10, 100 }, [](size_t size) {
+		return [flowers = std::make_shared<Flowers>(size)] {
+			auto json = JsonConvert::serialize(*flowers->root);
+			ojstreams out;
+			out.put(*json);
+			delete json;
+
+			JsonDocument document(out.getBuffer());
+			JsonConvert::Reset();
+			auto copy = JsonConvert::get<SceneObject*>(document.Root());
+			DeleteDecoded(copy, JsonConvert::objects());
+			JsonConvert::objects().clear();
+			return flowers->objects.size() + 1;
+		};
+	});
+}
+
+void AddUndo() {
+	// The size is the count of objects in the scene.
+	// Every state clones the whole scene, so --sizes=1000000 needs about 10 GB.
+	Benchmark::Add("Changes::Commit/Rollback", { 1000, 10000, 100000 }, [](size_t size) {
+		ResetScene();
+		for (size_t i = 0; i < size; i++)
+			Scene::Insert(new PointObject());
+		Changes::Commit();
+
+		return [size] {
+			auto o = Scene::Objects().Get().front().Get();
+			o->SetLocalPosition(o->GetLocalPosition() + glm::vec3(1));
+			Changes::Commit();
+			Changes::Rollback();
+			return size;
+		};
+	});
+}
+
+void AddHierarchy() {
+	// Every other object of the size is selected.
+	struct Groups {
+		GroupObject* root;
+		GroupObject* a;
+		GroupObject* b;
+		std::set<SceneObject*> selected;
+	};
+	auto create = [](size_t size) {
+		auto g = std::make_shared<Groups>();
+		g->root = ResetScene();
+		g->a = new GroupObject();
+		g->b = new GroupObject();
+		Scene::Insert(g->a);
+		Scene::Insert(g->b);
+		for (size_t i = 0; i < size; i++) {
+			auto o = new PointObject();
+			Scene::Insert(g->a, o);
+			if (i % 2 == 0)
+				g->selected.insert(o);
+		}
+		return g;
+	};
+
+	Benchmark::Add("Scene::CategorizeObjects", { 1000, 10000, 100000 }, [create](size_t size) {
+		return [g = create(size)] {
+			Scene::CategorizedObjects categorized;
+			Scene::CategorizeObjects(g->root, &g->selected, categorized);
+			return g->selected.size();
+		};
+	});
+	Benchmark::Add("Scene::MoveTo", { 100, 1000, 10000 }, [create](size_t size) {
+		// Moves the selection back and forth between the groups.
+		return [g = create(size), isInA = true]() mutable {
+			Scene::MoveTo(isInA ? g->b : g->a, 0, &g->selected, InsertPosition::Bottom);
+			isInA = !isInA;
+			return g->selected.size();
+		};
+	});
+}
+
+int main(int argc, char** argv) {
+	Log::MinLevel() = Log::Level::Warning;
+	Settings::PPI() = 96;
+	Settings::StateBufferLength() = 10;
+	Settings::ShouldDetectPosition() = false;
+	Settings::MoveCoordinateAction() = MoveCoordinateAction::Adapt;
+
+	Scene scene([] { return std::string("root"); });
+	Changes::RootObject() <<= scene.root();
+	Changes::Objects() <<= scene.Objects();
+
+	Camera camera;
+	Property<glm::vec2> viewSize = glm::vec2(1920, 1080);
+	camera.ViewSize <<= viewSize;
+	scene.camera = &camera;
+
+	AddProjection(camera);
+	AddCurves();
+	AddTransforms();
+	AddSerialization();
+	AddUndo();
+	AddHierarchy();
+
+	auto result = Benchmark::Run(argc, argv);
+	ResetScene();
+	return result;
+}
@@ -0,0 +1,80 @@
+// Nanoseconds per Event::Invoke with 1, 10 and 100 handlers.
+// The map of std::function the events used to have is measured alongside
+// for comparison.
+//
+// Usage: EventDispatchBenchmark [invoke count = 1000000, at least 100]
+
+#include "../InfrastructureTypes.hpp"
+#include <iostream>
+
+using Clock = std::chrono::steady_clock;
+
+// The previous implementation of Event reduced to the handler calls.
+template<typename...T>
+class MapEvent {
+	std::map<size_t, std::function<void(const T&...)>> handlers;
+public:
+	size_t AddHandler(std::function<void(const T&...)> func) {
+		static size_t id = 0;
+		handlers[id] = func;
+		return id++;
+	}
+	void Invoke(const T&... vs) {
+		for (auto h : handlers)
+			h.second(vs...);
+	}
+};
+
+size_t calledCount = 0;
+
+template<typename E>
+double Measure(E& e, size_t handlerCount, size_t invokeCount) {
+	// Capture like the handlers in the scene do.
+	auto* counter = &calledCount;
+	for (size_t i = 0; i < handlerCount; i++)
+		e.AddHandler([counter, i](const int& v) { *counter += v + i; });
+
+	// Warm up.
+	for (size_t i = 0; i < invokeCount / 10; i++)
+		e.Invoke(1);
+
+	auto start = Clock::now();
+	for (size_t i = 0; i < invokeCount; i++)
+		e.Invoke(1);
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / invokeCount;
+}
+
+int main(int argc, char** argv) {
+	const size_t handlerCounts[] = { 1, 10, 100 };
+
+	size_t invokeCount = 1000000;
+	try {
+		if (argc > 1)
+			invokeCount = std::stoull(argv[1]);
+	}
+	// Not a number. Reported with the usage like too few invokes.
+	catch (const std::exception&) {
+		invokeCount = 0;
+	}
+	// Every row needs at least one invoke. The last row has the most handlers.
+	if (invokeCount < handlerCounts[2]) {
+		std::cout << "Usage: EventDispatchBenchmark [invoke count, at least " << handlerCounts[2] << "]" << std::endl;
+		return 1;
+	}
+
+	for (size_t handlerCount : handlerCounts) {
+		Event<int> event;
+		MapEvent<int> mapEvent;
+		// Same number of calls per row.
+		auto count = invokeCount / handlerCount;
+
+		auto flat = Measure(event, handlerCount, count);
+		auto map = Measure(mapEvent, handlerCount, count);
+
+		std::cout << handlerCount << " handlers: "
+			<< "flat " << flat << " ns/invoke, "
+			<< "map " << map << " ns/invoke" << std::endl;
+	}
+
+	return calledCount ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// Compares face detector backends over a recording of a single viewer.
+// Reports detections per second, the share of frames where no face was found
+// and the jitter of the unfiltered viewer position.
+// Every frame is searched whole so only the detectors differ.
+// Frames are reduced for each detector as position detection does with the default settings.
+//
+// Usage: FaceDetectorBenchmark <video or directory of images> [max frame count = 600] [backends = haar lbp dnn]
+
+#include "../FrameSource.hpp"
+#include "../FaceTracking.hpp"
+#include "../PoseEstimation.hpp"
+#include <iostream>
+#include <cmath>
+
+void WriteUsage() {
+	std::cout << "Usage: FaceDetectorBenchmark <video or directory of images> [max frame count] [backends...]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		WriteUsage();
+		return 1;
+	}
+
+	size_t maxFrameCount = 600;
+	try {
+		if (argc > 2)
+			maxFrameCount = std::stoull(argv[2]);
+	}
+	catch (const std::exception&) {
+		WriteUsage();
+		return 1;
+	}
+
+	std::vector<std::string> backends(argv + std::min(argc, 3), argv + argc);
+	if (backends.empty())
+		backends = FaceDetectorBackend::All;
+
+	// Decode in advance so only the detection is measured.
+	ReplayFrameSource source(argv[1], false, false);
+	std::vector<cv::Mat> frames;
+	if (source.Open())
+		for (cv::Mat frame; frames.size() < maxFrameCount && source.Read(frame);)
+			frames.push_back(frame.clone());
+
+	if (frames.empty()) {
+		std::cout << "No frames read from " << argv[1] << std::endl;
+		return 1;
+	}
+	std::cout << frames.size() << " frames " << frames[0].cols << "x" << frames[0].rows << std::endl;
+
+	CameraSetup camera = { glm::vec2(frames[0].cols, frames[0].rows), glm::vec2(47, 35), glm::vec2(0, 65), 165, glm::vec3(0, 170, 30) };
+
+	for (auto& backend : backends) {
+		auto detector = FaceDetector::Create(backend);
+		if (!detector || !detector->Load()) {
+			std::cout << backend << ": failed to load" << std::endl;
+			continue;
+		}
+
+		DetectionFrameReducer reducer;
+		reducer.isColor = detector->IsColorNeeded();
+
+		FaceTracker tracker;
+		tracker.isTrackingEnabled = false;
+		tracker.isMotionGatingEnabled = false;
+
+		size_t misses = 0, jitterCount = 0;
+		glm::vec3 jitter(0), last;
+		bool hasLast = false;
+
+		auto start = std::chrono::steady_clock::now();
+		cv::Mat reduced;
+		for (auto& frame : frames) {
+			reducer.Reduce(frame, reduced, tracker.durations);
+			auto faces = tracker.Detect(*detector, reduced);
+			if (faces.empty()) {
+				misses++;
+				hasLast = false;
+				continue;
+			}
+
+			auto pose = PoseEstimator::Estimate(faces[0], reduced.size(), camera);
+			if (hasLast) {
+				auto d = pose - last;
+				jitter += d * d;
+				jitterCount++;
+			}
+			last = pose;
+			hasLast = true;
+		}
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (jitterCount)
+			jitter = glm::vec3(std::sqrt(jitter.x / jitterCount), std::sqrt(jitter.y / jitterCount), std::sqrt(jitter.z / jitterCount));
+
+		std::cout << backend << ": "
+			<< frames.size() / seconds << " detections/s, "
+			<< 100.0 * misses / frames.size() << "% missed, "
+			<< "jitter " << jitter.x << " " << jitter.y << " " << jitter.z << " mm" << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,96 @@
+// Per-frame face detection time with and without tracking.
+// Frames are decoded in advance so only the detection is measured.
+//
+// Usage: FaceTrackingBenchmark <video file or image sequence like frames/%04d.png>
+//     [detector = haar|lbp|dnn] [max frame count = 600]
+
+#include "../FaceTracking.hpp"
+#include "opencv2/videoio.hpp"
+#include <chrono>
+#include <iostream>
+#include <string>
+
+struct Result {
+	std::vector<double> milliseconds;
+	size_t framesWithFace = 0;
+};
+
+Result Run(FaceDetector& detector, const std::vector<cv::Mat>& frames, bool isTrackingEnabled) {
+	FaceTracker tracker;
+	tracker.isTrackingEnabled = isTrackingEnabled;
+	// Every frame has to be searched to compare the modes.
+	tracker.isMotionGatingEnabled = false;
+
+	Result result;
+	for (auto& frame : frames) {
+		auto start = std::chrono::steady_clock::now();
+		auto faces = tracker.Detect(detector, frame);
+		result.milliseconds.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+		if (!faces.empty())
+			result.framesWithFace++;
+	}
+
+	return result;
+}
+
+void Print(const char* name, Result r) {
+	std::sort(r.milliseconds.begin(), r.milliseconds.end());
+
+	double sum = 0;
+	for (auto v : r.milliseconds)
+		sum += v;
+
+	std::cout << name << ": "
+		<< "mean " << sum / r.milliseconds.size() << " ms, "
+		<< "median " << r.milliseconds[r.milliseconds.size() / 2] << " ms, "
+		<< "p95 " << r.milliseconds[r.milliseconds.size() * 95 / 100] << " ms, "
+		<< "face found in " << r.framesWithFace << "/" << r.milliseconds.size() << " frames" << std::endl;
+}
+
+void WriteUsage() {
+	std::cout << "Usage: FaceTrackingBenchmark <video or image sequence> [detector] [max frame count]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		WriteUsage();
+		return 1;
+	}
+
+	std::string backend = argc > 2 ? argv[2] : FaceDetectorBackend::Haar;
+	size_t maxFrameCount = 600;
+	try {
+		if (argc > 3)
+			maxFrameCount = std::stoull(argv[3]);
+	}
+	catch (const std::exception&) {
+		WriteUsage();
+		return 1;
+	}
+
+	auto detector = FaceDetector::Create(backend);
+	if (!detector || !detector->Load()) {
+		std::cout << "Failed to load face detector " << backend << std::endl;
+		return 1;
+	}
+
+	cv::VideoCapture capture(argv[1]);
+	std::vector<cv::Mat> frames;
+	for (cv::Mat frame; frames.size() < maxFrameCount && capture.read(frame) && !frame.empty();)
+		frames.push_back(frame.clone());
+
+	if (frames.empty()) {
+		std::cout << "No frames read from " << argv[1] << std::endl;
+		return 1;
+	}
+	std::cout << frames.size() << " frames " << frames[0].cols << "x" << frames[0].rows << std::endl;
+
+	// One pass to warm up caches and OpenCV's thread pool.
+	Run(*detector, frames, false);
+
+	Print("full frame", Run(*detector, frames, false));
+	Print("tracking", Run(*detector, frames, true));
+
+	return 0;
+}
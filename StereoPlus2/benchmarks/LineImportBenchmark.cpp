@@ -0,0 +1,119 @@
+// Throughput of OBJ and CSV polyline import.
+// Writes synthetic files of hand drawn like polylines to the temp directory
+// and parses them the same way FileManager::Load does.
+//
+// Usage: LineImportBenchmark [segment count = 10000000] [segments per polyline = 1000]
+
+#include "../LineImport.hpp"
+#include <filesystem>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace fs = std::filesystem;
+
+// Random walk polylines.
+template<typename TWriteVertex, typename TEndPolyline>
+void GeneratePolylines(size_t segmentCount, size_t segmentsPerPolyline, TWriteVertex writeVertex, TEndPolyline endPolyline) {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+	for (size_t polyline = 0; polyline * segmentsPerPolyline < segmentCount; polyline++) {
+		glm::vec3 v(polyline % 100, polyline / 100 % 100, 0);
+		auto count = std::min(segmentsPerPolyline, segmentCount - polyline * segmentsPerPolyline) + 1;
+
+		for (size_t i = 0; i < count; i++) {
+			writeVertex(polyline, v);
+			v += glm::vec3(step(random), step(random), step(random));
+		}
+		endPolyline(count);
+	}
+}
+
+void WriteObj(const fs::path& path, size_t segmentCount, size_t segmentsPerPolyline) {
+	std::ofstream file(path, std::ios::binary);
+	char buffer[64];
+
+	GeneratePolylines(segmentCount, segmentsPerPolyline,
+		[&](size_t, const glm::vec3& v) {
+			auto n = snprintf(buffer, sizeof(buffer), "v %.3f %.3f %.3f\n", v.x, v.y, v.z);
+			file.write(buffer, n);
+		},
+		[&](size_t count) {
+			// Relative indices to the vertices just written.
+			file << "l";
+			for (size_t i = count; i > 0; i--)
+				file << " -" << i;
+			file << "\n";
+		});
+}
+
+void WriteCsv(const fs::path& path, size_t segmentCount, size_t segmentsPerPolyline) {
+	std::ofstream file(path, std::ios::binary);
+	char buffer[96];
+
+	file << "id,x,y,z\n";
+	GeneratePolylines(segmentCount, segmentsPerPolyline,
+		[&](size_t polyline, const glm::vec3& v) {
+			auto n = snprintf(buffer, sizeof(buffer), "%zu,%.3f,%.3f,%.3f\n", polyline, v.x, v.y, v.z);
+			file.write(buffer, n);
+		},
+		[](size_t) {});
+}
+
+template<typename TImport>
+void Measure(const char* name, const fs::path& path, size_t segmentCount, TImport import) {
+	auto fileSize = fs::file_size(path);
+
+	auto start = std::chrono::steady_clock::now();
+	std::ifstream file(path, std::ios::binary);
+	auto lines = import(file);
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t vertexCount = 0;
+	for (auto& o : lines.objects)
+		vertexCount += o.vertices.size();
+
+	std::cout << name << ": "
+		<< fileSize / 1e6 << " MB, "
+		<< lines.objects.size() << " objects, "
+		<< vertexCount << " vertices, "
+		<< seconds << " s, "
+		<< fileSize / 1e6 / seconds << " MB/s, "
+		<< segmentCount / 1e6 / seconds << " M segments/s" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	size_t segmentCount = 10000000;
+	size_t segmentsPerPolyline = 1000;
+	try {
+		if (argc > 1)
+			segmentCount = std::stoull(argv[1]);
+		if (argc > 2)
+			segmentsPerPolyline = std::stoull(argv[2]);
+	}
+	// Not a number. Reported with the usage like a polyline without segments.
+	catch (const std::exception&) {
+		segmentsPerPolyline = 0;
+	}
+	if (segmentsPerPolyline == 0) {
+		std::cout << "Usage: LineImportBenchmark [segment count] [segments per polyline]" << std::endl;
+		return 1;
+	}
+
+	std::cout << "threads: " << std::max(1u, std::thread::hardware_concurrency()) << std::endl;
+
+	auto objPath = fs::temp_directory_path() / "LineImportBenchmark.obj";
+	auto csvPath = fs::temp_directory_path() / "LineImportBenchmark.csv";
+
+	WriteObj(objPath, segmentCount, segmentsPerPolyline);
+	Measure("obj", objPath, segmentCount, [](std::istream& in) { return ObjImporter::Import(in, "benchmark"); });
+	fs::remove(objPath);
+
+	WriteCsv(csvPath, segmentCount, segmentsPerPolyline);
+	Measure("csv", csvPath, segmentCount, [](std::istream& in) { return CsvPolylineImporter::Import(in); });
+	fs::remove(csvPath);
+
+	return 0;
+}
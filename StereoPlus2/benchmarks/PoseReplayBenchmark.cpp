@@ -0,0 +1,163 @@
+// Runs the viewer position pipeline over a recording as fast as possible.
+// Reports frames per second, time per stage and pose jitter.
+// Needs neither a camera nor a display.
+//
+// Usage: PoseReplayBenchmark <video file or directory of images>
+//     [detector = haar|lbp|dnn] [tracking = 1] [motion gating = 1] [detection frame height = 240]
+//
+// Camera setup matches the default settings.json except the resolution
+// which is taken from the recording.
+// Detection frame height of 0 keeps the recorded resolution
+// to compare with the reduced frames.
+
+#include "../FrameSource.hpp"
+#include "../FaceTracking.hpp"
+#include "../PoseEstimation.hpp"
+#include "../PoseFilter.hpp"
+#include <iostream>
+#include <cmath>
+
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration d) {
+	return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// Root mean square of differences between consecutive poses.
+class Jitter {
+	glm::vec3 sum = glm::vec3(0);
+	glm::vec3 last;
+	size_t count = 0;
+	bool hasLast = false;
+
+public:
+	void Add(const glm::vec3& pose) {
+		if (hasLast) {
+			auto d = pose - last;
+			sum += d * d;
+			count++;
+		}
+		last = pose;
+		hasLast = true;
+	}
+	glm::vec3 Get() const {
+		return count ? glm::vec3(std::sqrt(sum.x / count), std::sqrt(sum.y / count), std::sqrt(sum.z / count)) : glm::vec3(0);
+	}
+};
+
+std::ostream& operator<<(std::ostream& s, const glm::vec3& v) {
+	return s << v.x << " " << v.y << " " << v.z;
+}
+
+void WriteUsage() {
+	std::cout << "Usage: PoseReplayBenchmark <video or directory of images> [detector] [tracking] [motion gating] [detection frame height]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		WriteUsage();
+		return 1;
+	}
+
+	std::string backend = argc > 2 ? argv[2] : FaceDetectorBackend::Haar;
+	bool isTrackingEnabled = true;
+	bool isMotionGatingEnabled = true;
+	int frameHeight = 240;
+	try {
+		if (argc > 3)
+			isTrackingEnabled = std::stoi(argv[3]) != 0;
+		if (argc > 4)
+			isMotionGatingEnabled = std::stoi(argv[4]) != 0;
+		if (argc > 5)
+			frameHeight = std::stoi(argv[5]);
+	}
+	catch (const std::exception&) {
+		WriteUsage();
+		return 1;
+	}
+
+	auto detector = FaceDetector::Create(backend);
+	if (!detector || !detector->Load()) {
+		std::cout << "Failed to load face detector " << backend << std::endl;
+		return 1;
+	}
+
+	ReplayFrameSource source(argv[1], false, false);
+	if (!source.Open()) {
+		std::cout << "Failed to open " << argv[1] << std::endl;
+		return 1;
+	}
+
+	DetectionFrameReducer reducer;
+	reducer.height = frameHeight;
+	reducer.isColor = detector->IsColorNeeded();
+
+	FaceTracker tracker;
+	tracker.isTrackingEnabled = isTrackingEnabled;
+	tracker.isMotionGatingEnabled = isMotionGatingEnabled;
+
+	PoseFilter filter;
+	filter.minCutoff = 1;
+	filter.beta = 0.01f;
+
+	CameraSetup camera = { glm::vec2(), glm::vec2(47, 35), glm::vec2(0, 65), 165, glm::vec3(0, 170, 30) };
+
+	Clock::duration readTime{}, filterTime{};
+	Jitter rawJitter, filteredJitter;
+	size_t frameCount = 0, framesWithFace = 0;
+
+	cv::Mat captured, frame;
+	auto start = Clock::now();
+	for (;;) {
+		auto readStart = Clock::now();
+		if (!source.Read(captured))
+			break;
+		readTime += Clock::now() - readStart;
+
+		camera.resolution = glm::vec2(captured.cols, captured.rows);
+		reducer.Reduce(captured, frame, tracker.durations);
+		auto faces = tracker.Detect(*detector, frame);
+
+		// Recorded time rather than the time of processing.
+		auto time = frameCount++ / source.FrameRate();
+		if (faces.empty())
+			continue;
+		framesWithFace++;
+
+		auto filterStart = Clock::now();
+		auto pose = PoseEstimator::Estimate(faces[0], frame.size(), camera);
+		filter.Apply(pose, time);
+		auto filtered = filter.Value();
+		filterTime += Clock::now() - filterStart;
+
+		rawJitter.Add(pose);
+		filteredJitter.Add(filtered);
+	}
+	auto total = Clock::now() - start;
+
+	if (frameCount == 0) {
+		std::cout << "No frames read from " << argv[1] << std::endl;
+		return 1;
+	}
+
+	std::cout
+		<< "frames: " << frameCount << ", face found in " << framesWithFace << "\n"
+		<< "detection frame: " << frame.cols << "x" << frame.rows << "\n"
+		<< "tracking: " << (isTrackingEnabled ? "on" : "off") << "\n"
+		<< "motion gating: " << (isMotionGatingEnabled ? "on" : "off") << ", " << tracker.skippedFrameCount << " frames skipped\n"
+		<< "frames per second: " << frameCount / std::chrono::duration<double>(total).count() << "\n"
+		<< "ms per frame:\n"
+		<< "  read " << Milliseconds(readTime) / frameCount << "\n"
+		<< "  downscale " << Milliseconds(tracker.durations.downscale) / frameCount << "\n"
+		<< "  gray conversion " << Milliseconds(tracker.durations.grayConversion) / frameCount << "\n"
+		<< "  equalizeHist " << Milliseconds(tracker.durations.equalization) / frameCount << "\n"
+		<< "  detection " << Milliseconds(tracker.durations.detection) / frameCount << "\n"
+		<< "  motion check " << Milliseconds(tracker.durations.motionCheck) / frameCount << "\n"
+		<< "  filtering " << Milliseconds(filterTime) / frameCount << "\n"
+		<< "  total " << Milliseconds(total) / frameCount << "\n"
+		<< "jitter between frames (mm, horizontal vertical distance):\n"
+		<< "  raw " << rawJitter.Get() << "\n"
+		<< "  filtered " << filteredJitter.Get() << std::endl;
+
+	return 0;
+}
@@ -19,13 +19,21 @@
 using namespace std;
 
 bool CustomRenderFunc(Scene& scene, Renderer& renderPipeline, PositionDetector& positionDetector) {
+	static std::chrono::steady_clock::time_point appliedPoseCaptureTime;
+
 	// Modify camera posiiton when Posiiton detection is enabled.
-	if (positionDetector.isPositionProcessingWorking)
-		scene.camera->PositionModifier =
-		glm::vec3(
-			positionDetector.positionHorizontal.load(),
-			positionDetector.positionVertical.load(),
-			positionDetector.distance.load());
+	// The scene is redrawn only for a pose that hasn't been applied yet.
+	if (positionDetector.GetStatus() == PositionDetector::Status::Running)
+		if (auto& pose = positionDetector.GetPose(); pose.isValid && pose.captureTime != appliedPoseCaptureTime) {
+			appliedPoseCaptureTime = pose.captureTime;
+			scene.camera->PositionModifier = pose.position;
+			MotionToPhotonLatency::PoseSampled(pose.captureTime);
+			FrameScheduler::RequestRedraw();
+		}
+
+	// The window keeps showing the last drawn image.
+	if (!FrameScheduler::TakeSceneChange() && Settings::IsRenderOnDemandEnabled().Get())
+		return true;
 
 	// Run scene drawing.
 	renderPipeline.Pipeline(scene);
@@ -80,17 +88,25 @@ void ConfigureShortcuts(CustomRenderWindow& crw) {
 
 int main() {
 	//Time::Init();
-
-	Settings::LogFileName().OnChanged() += [](const std::string& v) { Log::LogFileName() = v; };
-	SettingsLoader::Load();
-
-	if (!LocaleProvider::Init())
-		return false;
+	StartupTimer::Start();
 
 	//LogWindow logWindow;
 	//Log::AdditionalLogOutput() = [&](const std::string& v) { logWindow.Logs += v; };
+	// Set first so the startup phases are logged
+	// and before another thread can read it.
 	Log::Sink() = Log::ConsoleSink;
 
+	Settings::LogFileName().OnChanged() += [](const std::string& v) { Log::LogFileName() = v; };
+	{
+		// Everything else depends on the settings.
+		StartupTimer::Phase phase("Settings");
+		SettingsLoader::Load();
+	}
+
+	// The locale and the face detectors are loaded on their own threads
+	// while the window, the GL context and the shaders are created on this one.
+	auto isLocaleLoaded = LocaleProvider::InitAsync();
+
 	// Declare main components.
 	PositionDetector positionDetector;
 
@@ -103,6 +119,8 @@ int main() {
 
 	SettingsWindow settingsWindow;
 	settingsWindow.IsOpen = true;
+	ProfilerWindow profilerWindow;
+	MemoryWindow memoryWindow;
 
 	Renderer renderPipeline;
 	GUI gui;
@@ -110,6 +128,12 @@ int main() {
 	if (!renderPipeline.Init())
 		return false;
 
+	{
+		StartupTimer::Phase phase("Waiting for the locale");
+		if (!isLocaleLoaded.get())
+			return false;
+	}
+
 	Scene scene([] { return LocaleProvider::Get("object:root"); });
 	Camera camera;
 	Cross cross;
@@ -139,16 +163,24 @@ int main() {
 		(Window*)&attributesWindow,
 		(Window*)&toolWindow,
 		(Window*)&settingsWindow,
+		(Window*)&profilerWindow,
+		(Window*)&memoryWindow,
 		//(Window*)&logWindow,
 	};
 	gui.glWindow = renderPipeline.glWindow;
 	gui.glsl_version = renderPipeline.glsl_version;
 	gui.scene = &scene;
 	gui.settingsWindow = &settingsWindow;
+	gui.profilerWindow = &profilerWindow;
+	gui.memoryWindow = &memoryWindow;
 	gui.renderViewport = [&customRenderWindow] { customRenderWindow.shouldSaveViewportImage = true; };
 	gui.renderAdvanced = [&customRenderWindow] { customRenderWindow.shouldSaveAdvancedImage = true; };
-	if (!gui.Init())
-		return false;
+	gui.lateRenderFunc = [&customRenderWindow] { return customRenderWindow.RenderScene(); };
+	{
+		StartupTimer::Phase phase("GUI");
+		if (!gui.Init())
+			return false;
+	}
 
 	cross.Name = "Cross";
 	cross.GUIPositionEditHandler = [] { Input::movement() += Scene::cross()->GUIPositionEditDifference; };
@@ -171,13 +203,22 @@ int main() {
 	cross.keyboardBindingHandlerId = Input::AddHandler(cross.keyboardBindingHandler);
 
 	camera.keyboardBindingProcessor = [&camera] { 
-		camera.PositionModifier = camera.PositionModifier.Get() + Input::GetRelativeMovement(glm::vec3());
-		camera.ForceUpdateCache();
+		if (auto relativeMovement = Input::GetRelativeMovement(glm::vec3()); relativeMovement != glm::vec3()) {
+			camera.PositionModifier = camera.PositionModifier.Get() + relativeMovement;
+			camera.ForceUpdateCache();
+		}
 	};
 
 	if (!ToolPool::Init())
 		return false;
 
+	{
+		// Restore autosaves of sessions that didn't exit properly.
+		// Decoded objects create GL buffers so it stays on this thread.
+		StartupTimer::Phase phase("Journal recovery");
+		FileManager::RecoverJournals("scenes");
+	}
+
 
 	Changes::RootObject() <<= scene.root();
 	Changes::Objects() <<= scene.Objects();
@@ -194,10 +235,13 @@ int main() {
 		ObjectSelection::RemoveAll();
 	};
 
-	// Position detector doesn't initialize itself
-	// so we need to help it.
-	positionDetector.onStartProcess = [&positionDetector] {
-		positionDetector.Init();
+	// Selected objects are drawn brighter and undo replaces the objects.
+	ObjectSelection::OnChanged() += [](const ObjectSelection::Selection&) { FrameScheduler::RequestRedraw(); };
+	Changes::OnStateChange() += [] { FrameScheduler::RequestRedraw(); };
+
+	// Switch to the newly selected source of the viewer position.
+	Settings::PoseProvider().OnChanged() += [&positionDetector](const std::string&) {
+		positionDetector.RestartPositionDetection();
 	};
 
 	// Track the state of Position detector to switch it
@@ -205,10 +249,15 @@ int main() {
 	// Reads user position and modifies camera position when enabled.
 	// Calls drawing methods of Renderer.
 	customRenderWindow.customRenderFunc = [&scene, &renderPipeline, &positionDetector]{
-		if (Settings::ShouldDetectPosition().Get() && !positionDetector.isPositionProcessingWorking)
+		// Neither waits for the detection thread.
+		if (Settings::ShouldDetectPosition().Get())
 			positionDetector.StartPositionDetection();
-		else if (!Settings::ShouldDetectPosition().Get() && positionDetector.isPositionProcessingWorking)
+		else
 			positionDetector.StopPositionDetection();
+
+		if (auto& status = PositionDetector::GetStatusName(positionDetector.GetStatus());
+			status != ReadOnlyState::PositionDetectionStatus().Get())
+			ReadOnlyState::PositionDetectionStatus() = status;
 		 
 		return CustomRenderFunc(scene, renderPipeline, positionDetector);
 	};
@@ -225,13 +274,15 @@ int main() {
 	if (Settings::IsAutosaveEnabled().Get()) {
 		auto autosaveCommand = new AutosaveCommand();
 		autosaveCommand->SetFunc([filename = AutosaveCommand::GetFileName()] {
-			FileManager::Save(filename, Scene::scene());
+			FileManager::SaveChangesAsync(filename, Scene::scene());
 			});
 		autosaveCommand->StartNew(Settings::AutosavePeriodMinutes().Get());
 	}
 
 	ConfigureShortcuts(customRenderWindow);
 
+	FrameScheduler::RequestRedraw();
+
 	// Start the main loop and clean the memory when closed.
 	// Bitwise OR is intended. 
 	// We must go through all of them even if we get 1 false.
@@ -0,0 +1,72 @@
+// Json that settings, locales and scenes are parsed from.
+// Malformed text must throw instead of leaving the parser where it is.
+//
+// Usage: JsonTest
+
+#include "../Json.hpp"
+#include <iostream>
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& test, const char* what) {
+	if (condition)
+		return;
+
+	std::cout << test << ": " << what << std::endl;
+	failureCount++;
+}
+
+bool Parses(const std::string& text) {
+	try {
+		JsonDocument document{ std::string(text) };
+		return document.Root() != nullptr;
+	}
+	catch (const std::runtime_error&) {
+		return false;
+	}
+}
+
+void Valid() {
+	for (auto text : {
+		"{}",
+		"[]",
+		"1",
+		"{\"a\":1,\"b\":[1,2,3],\"c\":{\"d\":\"e\"}}",
+		" { \"a\" : [ 1 , 2 ] , \"b\" : true } ",
+		// Trailing commas are accepted.
+		"[1,2,]",
+		"{\"a\":1,}",
+		})
+		Check(Parses(text), text, "expected to parse");
+
+	JsonDocument document("{\"b\":[1, 2.5],\"a\":\"x\"}");
+	auto root = (const Jv::Object*)document.Root();
+	Check(root->type == Jv::JObject && root->size == 2, "values", "expected 2 members");
+	auto b = (const Jv::Array*)root->Find("b");
+	Check(b && b->size == 2 && ((const Jv::Primitive*)b->objects[1])->value == "2.5", "values", "wrong array");
+}
+
+void Malformed() {
+	for (auto text : {
+		"[1 }",
+		"{\"a\":[1,}",
+		"{\"a\":1 ]",
+		"[1 2]",
+		"{\"a\":1 \"b\":2}",
+		"[,]",
+		"{\"a\":}",
+		"[1,",
+		"{\"a\":\"b",
+		"{1:2}",
+		})
+		Check(!Parses(text), text, "expected to throw");
+}
+
+int main() {
+	Valid();
+	Malformed();
+
+	if (failureCount == 0)
+		std::cout << "All tests passed" << std::endl;
+	return failureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+// OBJ and CSV files with lines longer than the block the parser reads at once.
+// The block grows until the line fits and the line must come out whole.
+//
+// Usage: LineImportTest
+
+#include "../LineImport.hpp"
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Small enough for every line of the files below to be longer than a block.
+constexpr size_t blockSize = 8;
+
+int failureCount = 0;
+
+void Check(bool condition, const char* test, const char* what) {
+	if (condition)
+		return;
+
+	std::cout << test << ": " << what << std::endl;
+	failureCount++;
+}
+
+fs::path WriteFile(const std::string& name, const std::string& text) {
+	auto path = fs::temp_directory_path() / name;
+	std::ofstream(path, std::ios::binary) << text;
+	return path;
+}
+
+void ObjWithLongLine() {
+	const auto test = "ObjWithLongLine";
+	const size_t vertexCount = 2000;
+
+	// One "l" record through all vertices is several KB long.
+	std::stringstream text;
+	text << "o long line\n";
+	for (size_t i = 0; i < vertexCount; i++)
+		text << "v " << i << " " << i * 2 << " " << i * 3 << "\n";
+	text << "l";
+	for (size_t i = 1; i <= vertexCount; i++)
+		text << " " << i;
+	text << "\nv 0 0 0\n";
+
+	auto path = WriteFile("LineImportTest.obj", text.str());
+	std::ifstream file(path, std::ios::binary);
+	auto lines = ObjImporter::Import(file, "default", blockSize);
+
+	Check(lines.objects.size() == 1, test, "expected 1 object");
+	if (lines.objects.empty())
+		return;
+
+	auto& o = lines.objects[0];
+	Check(o.name == "long line", test, "wrong object name");
+	Check(o.vertices.size() == vertexCount, test, "wrong vertex count");
+	Check(o.connections.size() == vertexCount - 1, test, "wrong connection count");
+	if (o.vertices.size() == vertexCount)
+		Check(o.vertices.back() == glm::vec3(vertexCount - 1, (vertexCount - 1) * 2, (vertexCount - 1) * 3), test, "wrong last vertex");
+}
+
+void CsvWithLongLine() {
+	const auto test = "CsvWithLongLine";
+
+	// The id of the second polyline is longer than a block.
+	auto longId = std::string(5000, 'a');
+	auto path = WriteFile("LineImportTest.csv",
+		"id,x,y,z\n"
+		"1,0,0,0\n"
+		"1,1,1,1\n"
+		+ longId + ",2,2,2\n"
+		+ longId + ",3,3,3\n");
+	std::ifstream file(path, std::ios::binary);
+	auto lines = CsvPolylineImporter::Import(file, blockSize);
+
+	Check(lines.objects.size() == 2, test, "expected 2 polylines");
+	if (lines.objects.size() != 2)
+		return;
+
+	Check(lines.objects[0].vertices.size() == 2, test, "wrong vertex count of the first polyline");
+	Check(lines.objects[1].name == longId, test, "long id was cut");
+	Check(lines.objects[1].vertices.size() == 2, test, "wrong vertex count of the second polyline");
+	if (lines.objects[1].vertices.size() == 2)
+		Check(lines.objects[1].vertices[1] == glm::vec3(3, 3, 3), test, "wrong last vertex");
+}
+
+void ObjWithIndexAbove32Bits() {
+	const auto test = "ObjWithIndexAbove32Bits";
+
+	// Cut to 32 bits the index would point to the second vertex.
+	auto path = WriteFile("LineImportTest32.obj", "v 0 0 0\nv 1 1 1\nl 1 4294967298\n");
+	std::ifstream file(path, std::ios::binary);
+
+	auto thrown = false;
+	try {
+		ObjImporter::Import(file, "default", blockSize);
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	Check(thrown, test, "expected an out of range error");
+}
+
+int main() {
+	ObjWithLongLine();
+	CsvWithLongLine();
+	ObjWithIndexAbove32Bits();
+
+	if (failureCount == 0)
+		std::cout << "All tests passed" << std::endl;
+	return failureCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+// Sends a viewer moving in front of the screen to the external pose input
+// to test it without a tracker.
+// The position goes round an ellipse in front of the screen center.
+//
+// Usage: ExternalPoseSender <udp|sharedMemory> [port or shared memory name] [poses per second = 60]
+
+#include "../ExternalPose.hpp"
+#include <iostream>
+#include <cmath>
+
+void WriteUsage() {
+	std::cout << "Usage: ExternalPoseSender <udp|sharedMemory> [port or shared memory name] [poses per second]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		WriteUsage();
+		return 1;
+	}
+
+	std::string provider = argv[1];
+	int port = 27182;
+	std::string name = provider == PoseProvider::SharedMemory && argc > 2 ? argv[2] : "StereoPlus2Pose";
+	double rate = 60;
+	try {
+		if (provider == PoseProvider::Udp && argc > 2)
+			port = std::stoi(argv[2]);
+		if (argc > 3)
+			rate = std::stod(argv[3]);
+	}
+	// Not a number.
+	catch (const std::exception&) {
+		port = 0;
+	}
+	if (port < 1 || port > 65535 || !(rate > 0)) {
+		WriteUsage();
+		return 1;
+	}
+
+	auto sender = ExternalPoseSender::Create(provider, port, name);
+	if (!sender || !sender->Open()) {
+		std::cout << "Failed to open " << provider << std::endl;
+		return 1;
+	}
+
+	ExternalPoseMessage message;
+	auto start = std::chrono::steady_clock::now();
+	for (;; message.sequence++) {
+		auto time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		message.captureTimeMicroseconds = ExternalPoseMessage::Now();
+		message.position[0] = (float)(150 * std::sin(time));
+		message.position[1] = (float)(50 * std::sin(time * 2));
+		message.position[2] = (float)(600 + 100 * std::cos(time));
+
+		if (!sender->Send(message))
+			std::cout << "Failed to send pose " << message.sequence << std::endl;
+
+		std::this_thread::sleep_until(start + std::chrono::duration<double>((message.sequence + 1) / rate));
+	}
+}
@@ -0,0 +1,63 @@
+// Loads a scene without a window, draws it once and prints the memory held by each subsystem.
+// Every commit adds a state to the undo history like an edit in the application does.
+//
+// Usage: MemoryReport <scene file> [commits = 10]
+
+#include "../FileManager.hpp"
+#include <iostream>
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cout << "Usage: MemoryReport <scene file> [commits]" << std::endl;
+		return 1;
+	}
+
+	size_t commitCount = 10;
+	try {
+		if (argc > 2)
+			commitCount = std::stoul(argv[2]);
+	}
+	catch (const std::exception&) {
+		std::cout << "Invalid commit count " << argv[2] << std::endl;
+		std::cout << "Usage: MemoryReport <scene file> [commits]" << std::endl;
+		return 1;
+	}
+
+	Log::MinLevel() = Log::Level::Warning;
+	Settings::PPI() = 96;
+	Settings::StateBufferLength() = commitCount;
+	Settings::ShouldDetectPosition() = false;
+
+	Scene scene([] { return std::string("root"); });
+	Changes::RootObject() <<= scene.root();
+	Changes::Objects() <<= scene.Objects();
+
+	Camera camera;
+	Property<glm::vec2> viewSize = glm::vec2(1920, 1080);
+	camera.ViewSize <<= viewSize;
+	scene.camera = &camera;
+
+	try {
+		FileManager::Load(argv[1], &scene);
+	}
+	catch (...) {
+		std::cout << "Failed to load " << argv[1] << std::endl;
+		return 1;
+	}
+
+	// Fills the eye buffers the way the renderer does.
+	for (auto& o : Scene::Objects().Get())
+		o->UdateBuffer(
+			[&camera](const glm::vec3& p) { return camera.GetLeft(p); },
+			[&camera](const glm::vec3& p) { return camera.GetRight(p); });
+
+	for (size_t i = 0; i < commitCount; i++)
+		Changes::Commit();
+
+	Scene::CountMemory();
+	std::cout << Scene::Objects()->size() << " objects, " << commitCount << " commits" << std::endl;
+	MemoryUsage::WriteReport(std::cout);
+
+	Changes::Clear();
+	return 0;
+}